@@ -0,0 +1,342 @@
+#include "analyze.h"
+
+// returns expr, with its special forms and global references marked
+Obj analyze(Obj expr) {
+	// a bare name at top level is left alone (it might be .quit)
+	if (GETTAG(expr) != LIST)
+		return expr;
+
+	expr = mark_globals(mark_forms(expr), NULL);
+
+	// flat closures are only for the interpreter
+	if (FLAT && !COMPILE)
+		expr = flatten(expr, scan_assigned(expr, NULL), NULL);
+
+	return expr;
+}
+
+/* special forms */
+
+Obj mark_forms(Obj expr) {
+	if (GETTAG(expr) != LIST)
+		return expr;
+
+	List* list = GETLIST(expr);
+
+	if (list == NULL)
+		return expr;
+
+	Obj head = CAR(list);
+	CAR(list) = keyword_form(head);
+
+	if (GETTAG(CAR(list)) != FORM) {
+		// application: operator and operands
+		analyze_list(list);
+		return expr;
+	}
+
+	switch (GETFORM(CAR(list))) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+			break;
+		case LAMBDA_FORM:
+			// skip the parameter list
+			if (CDR(list) == NULL)
+				break;
+			analyze_list(CDDR(list));
+			// (but not if it's been done already)
+			if (GETTAG(head) == NAME)
+				scan_out_defines(list);
+			break;
+		case ASS_FORM:
+		case DEF_FORM:
+			// skip the variable name
+			if (CDR(list))
+				analyze_list(CDDR(list));
+			break;
+		case BEGIN_FORM:
+		case IF_FORM:
+			analyze_list(CDR(list));
+			break;
+		default:
+			break;
+	}
+
+	return expr;
+}
+
+/* (lambda params . body) becomes (lambda params locals
+	. body), where locals are the names defined in the
+	body, so the procedure's frame can have a slot for
+	each of them from the start (SICP 4.1.6). A define
+	of a param already has a slot (the param's), so
+	it's just an assignment and doesn't get another */
+void scan_out_defines(List* lambda) {
+	List* params = GETTAG(CADR(lambda)) == LIST ? GETLIST(CADR(lambda)) : NULL;
+	List* names = NULL;
+	for (List* body = CDDR(lambda); body; body = CDR(body))
+		names = scan_defines(CAR(body), names);
+
+	List* locals = NULL;
+	for (; names; names = CDR(names))
+		if (!hasName(GETNAME(CAR(names)), params))
+			locals = makeList(CAR(names), locals);
+
+	CDR(CDR(lambda)) = makeList(LISTOBJ(locals), CDDR(lambda));
+}
+
+void analyze_list(List* list) {
+	while (list) {
+		CAR(list) = mark_forms(CAR(list));
+		list = CDR(list);
+	}
+}
+
+// converts a keyword NAME to its FORM (anything else is returned as is)
+Obj keyword_form(Obj head) {
+	if (GETTAG(head) != NAME)
+		return head;
+
+	Symbol* sym = GETNAME(head);
+
+			if (DEBUG) printf("analyzing \"%s\"\n", sym->name);
+
+	// keyword ids match their Forms (see symbol.c)
+	if (isKeyword(sym))
+		return FORMOBJ(sym->id);
+
+	return head;
+}
+
+/* global references */
+
+Obj mark_globals(Obj expr, Scope* scope) {
+	if (isVar(expr))
+		return isBound(GETNAME(expr), scope) ?
+			expr : makeGlobalRef(expr);
+
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return expr;
+
+	List* list = GETLIST(expr);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+		case GLOBAL_FORM:
+		case FLAT_LAMBDA_FORM:
+		case FREE_FORM:
+			break;
+		case LAMBDA_FORM: {
+			if (CDR(list) == NULL)
+				break;
+			Scope inner = lambda_scope(expr, scope);
+			mark_globals_list(CDDDR(list), &inner);
+			break;
+		}
+		case ASS_FORM:
+		case DEF_FORM:
+			// skip the variable name
+			if (CDR(list))
+				mark_globals_list(CDDR(list), scope);
+			break;
+		case BEGIN_FORM:
+		case IF_FORM:
+			mark_globals_list(CDR(list), scope);
+			break;
+		default:
+			// application: operator and operands
+			mark_globals_list(list, scope);
+	}
+
+	return expr;
+}
+
+void mark_globals_list(List* list, Scope* scope) {
+	while (list) {
+		CAR(list) = mark_globals(CAR(list), scope);
+		list = CDR(list);
+	}
+}
+
+// bound by an enclosing lambda, as a parameter or an internal define
+bool isBound(Symbol* var, Scope* scope) {
+	for (; scope; scope = scope->enclosure)
+		if (hasName(var, scope->vars) || hasName(var, scope->defines))
+			return true;
+	return false;
+}
+
+/* flat closures */
+
+// conses onto names every variable that's set! or defined anywhere in expr
+List* scan_assigned(Obj expr, List* names) {
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return names;
+
+	List* list = GETLIST(expr);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+		case GLOBAL_FORM:
+		case FREE_FORM:
+			return names;
+		case ASS_FORM:
+		case DEF_FORM: {
+			Obj var = CADR(list);
+			if (isVar(var) && !hasName(GETNAME(var), names))
+				names = makeList(var, names);
+			return CDDR(list) ?
+				scan_assigned(CADDR(list), names) : names;
+		}
+		default:
+			// lambda bodies included
+			for (; list; list = CDR(list))
+				names = scan_assigned(CAR(list), names);
+			return names;
+	}
+}
+
+/* conses onto free every variable referenced in expr that
+	isn't bound in scope, where the outermost scope is the
+	lambda whose free variables these are (globals have
+	already been marked, so everything left is a local of
+	some enclosing lambda) */
+List* free_vars(Obj expr, Scope* scope, List* free) {
+	if (isVar(expr)) {
+		Symbol* var = GETNAME(expr);
+		if (!isBound(var, scope) && !hasName(var, free))
+			free = makeList(expr, free);
+		return free;
+	}
+
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return free;
+
+	List* list = GETLIST(expr);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+		case GLOBAL_FORM:
+		case FREE_FORM:
+		case FLAT_LAMBDA_FORM:
+			return free;
+		case LAMBDA_FORM: {
+			if (CDR(list) == NULL)
+				return free;
+			Scope inner = lambda_scope(expr, scope);
+			return free_vars_list(CDDDR(list), &inner, free);
+		}
+		default:
+			// a set! target counts as a reference
+			return free_vars_list(list, scope, free);
+	}
+}
+
+List* free_vars_list(List* list, Scope* scope, List* free) {
+	for (; list; list = CDR(list))
+		free = free_vars(CAR(list), scope, free);
+	return free;
+}
+
+Scope lambda_scope(Obj lambda, Scope* enclosure) {
+	Obj params = lambdaParams(lambda);
+	Scope scope = {
+		.vars = GETTAG(params) == LIST ? GETLIST(params) : NULL,
+		.defines = GETLIST(lambdaLocals(lambda)),
+		.enclosure = enclosure
+	};
+	return scope;
+}
+
+// replaces the variables in free with their slots in the closure
+Obj flatten(Obj expr, List* assigned, List* free) {
+	if (isVar(expr)) {
+		int index = name_index(GETNAME(expr), free);
+		return index < 0 ? expr : makeFreeRef(expr, index);
+	}
+
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return expr;
+
+	List* list = GETLIST(expr);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+		case GLOBAL_FORM:
+		case FREE_FORM:
+		case FLAT_LAMBDA_FORM:
+			break;
+		case LAMBDA_FORM:
+			flatten_lambda(expr, assigned, free);
+			break;
+		case ASS_FORM:
+		case DEF_FORM:
+			// skip the variable name
+			if (CDR(list))
+				flatten_list(CDDR(list), assigned, free);
+			break;
+		default:
+			flatten_list(list, assigned, free);
+	}
+
+	return expr;
+}
+
+void flatten_list(List* list, List* assigned, List* free) {
+	for (; list; list = CDR(list))
+		CAR(list) = flatten(CAR(list), assigned, free);
+}
+
+/* (lambda params locals . body) becomes (FLAT_LAMBDA
+	params locals captures . body), where captures are the lambda's free
+	variables as they're referred to from outside it. a
+	lambda with a free variable that's ever assigned keeps
+	its linked env, since a copy would go stale (and so
+	its free variables stay plain names) */
+void flatten_lambda(Obj lambda, List* assigned, List* free) {
+	List* list = GETLIST(lambda);
+
+	if (CDR(list) == NULL)
+		return;
+
+	Scope scope = lambda_scope(lambda, NULL);
+	List* lambda_free = free_vars_list(CDDDR(list), &scope, NULL);
+
+	for (List* temp = lambda_free; temp; temp = CDR(temp))
+		if (hasName(GETNAME(CAR(temp)), assigned)) {
+			flatten_list(CDDDR(list), assigned, NULL);
+			return;
+		}
+
+	List* captures = NULL;
+	for (List* temp = lambda_free; temp; temp = CDR(temp))
+		captures = makeList(flatten(CAR(temp), assigned, free), captures);
+	captures = reverse_list(captures);
+
+	flatten_list(CDDDR(list), assigned, lambda_free);
+
+	CAR(list) = FORMOBJ(FLAT_LAMBDA_FORM);
+	CDR(CDDR(list)) = makeList(LISTOBJ(captures), CDDDR(list));
+}
+
+int name_index(Symbol* var, List* names) {
+	for (int i = 0; names; names = CDR(names), i++)
+		if (GETNAME(CAR(names)) == var)
+			return i;
+	return -1;
+}
+
+List* reverse_list(List* list) {
+	List* reversed = NULL;
+	while (list) {
+		List* next = CDR(list);
+		CDR(list) = reversed;
+		reversed = list;
+		list = next;
+	}
+	return reversed;
+}
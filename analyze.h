@@ -0,0 +1,119 @@
+/*
+	ANALYZE
+
+	Before this pass existed, every visit to EVAL
+	ran isQuote, isLambda, isBegin, etc. one after
+	another, and each of those did a strcmp against
+	the head of the expression. A lambda body that
+	gets evaluated a million times was classified
+	a million times.
+
+	SICP 4.1.7 fixes this by separating syntactic
+	analysis from execution. analyze walks a freshly
+	parsed expression once and replaces the keyword
+	at the head of each special form with a FORM Obj
+	whose val is a Form enum (see objects.h). After
+	that, classifying an expression is just a tag
+	check and an integer load (see formOf in llh.c):
+
+		-- NUM and NAME Objs are constants and
+			variables, as before
+		-- a LIST whose car is a FORM is the
+			corresponding special form
+		-- any other LIST is an application
+
+	The analysis is done in place, so the parsed
+	list structure (and everything that walks it,
+	like print_obj) stays the same. Quoted text is
+	left alone, as are lambda parameter lists and
+	the names in define and set!. Analyzing an
+	already-analyzed expression is harmless.
+
+	The one change in shape is that internal
+	defines are scanned out, as in SICP 4.1.6:
+	each lambda gets a list of the names defined
+	in its body, right after its parameters, as
+	(lambda params locals . body). A procedure's
+	frame is made with a slot for each of them up
+	front (see extendEnv in env.c), so it never has
+	to grow while the body runs, and its layout is
+	known before the body runs. (print_obj leaves
+	the list out.)
+
+	A second walk finds the variable references
+	that can only be global: names that aren't a
+	parameter or an internal define of any
+	enclosing lambda (the same test compile.c uses
+	for its GLOBAL_LOOKUP). Each one is replaced by
+	a small list (GLOBAL name index version) that
+	the evaluator uses as an inline cache: the
+	index of the name's binding in base_env's
+	frame, good as long as version matches the
+	global version (see env.c). Everything else
+	(locals, and the top-level expression itself)
+	is left as a plain NAME and looked up as before.
+	print_obj prints a global reference as its
+	name, so none of this shows.
+
+	In flat mode (.flat, interpreter only), a
+	third walk does closure conversion. SICP's
+	closures keep the whole env they were made
+	in, so a closure that uses one variable keeps
+	every frame above it alive. Instead, each
+	lambda's free variables are worked out ahead
+	of time, the lambda becomes (FLAT_LAMBDA params
+	captures . body), and the references to them
+	in its body become (FREE index name). Making
+	the closure copies just the captured values
+	into an env of its own (see makeFlatFunc in
+	llh.c), and a FREE reference is a load from
+	that env by index. Copying is only safe for
+	variables that never change, so a lambda with
+	a free variable that's set! or defined
+	anywhere is left as an ordinary lambda.
+*/
+
+#ifndef ANALYZE_GUARD
+#define ANALYZE_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "objects.h"
+#include "keywords.h"
+#include "flags.h"
+#include "symbol.h"
+#include "llh.h"
+
+/* the names bound by each enclosing lambda */
+
+typedef struct Scope Scope;
+
+struct Scope {
+	List* vars;
+	List* defines;
+	Scope* enclosure;
+};
+
+Obj analyze(Obj expr);
+
+	Obj mark_forms(Obj expr);
+	void scan_out_defines(List* lambda);
+	void analyze_list(List* list);
+	Obj keyword_form(Obj head);
+
+	Obj mark_globals(Obj expr, Scope* scope);
+	void mark_globals_list(List* list, Scope* scope);
+	bool isBound(Symbol* var, Scope* scope);
+
+	List* scan_assigned(Obj expr, List* names);
+	List* free_vars(Obj expr, Scope* scope, List* free);
+	List* free_vars_list(List* list, Scope* scope, List* free);
+	Scope lambda_scope(Obj lambda, Scope* enclosure);
+	Obj flatten(Obj expr, List* assigned, List* free);
+	void flatten_list(List* list, List* assigned, List* free);
+	void flatten_lambda(Obj lambda, List* assigned, List* free);
+	int name_index(Symbol* var, List* names);
+	List* reverse_list(List* list);
+
+#endif
@@ -0,0 +1,561 @@
+#include "compile.h"
+
+#define VAL REGBIT(VAL_REG)
+#define CONT REGBIT(CONT_REG)
+#define FUNC REGBIT(FUNC_REG)
+#define ARGLIST REGBIT(ARGLIST_REG)
+#define ENV REGBIT(ENV_REG)
+
+#define NO_OBJ UNINITOBJ
+#define NO_LABEL 0
+
+/* labels are numbered from 0 for each top-level expression */
+
+int label_counter = 0;
+
+/* top-level code that doesn't make any procedures
+	can't be reached once the next expression comes
+	along, so it's released then */
+
+Instr* disposable_code;
+
+Instr* compile_code(Obj expr) {
+			if (DEBUG) printf("%s\n", "compiling...");
+	if (disposable_code) {
+		release_code(disposable_code);
+		disposable_code = NULL;
+	}
+
+	label_counter = 0;
+	Seq seq = compile(expr, VAL_REG, RETURN, NULL);
+	bool disposable = !makesProcedures(seq);
+	Instr* code = assemble(seq);
+
+	if (disposable)
+		disposable_code = code;
+	return code;
+}
+
+/* compilers for each kind of expression */
+
+Seq compile(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env) {
+	if (isNum(expr))
+		return compile_self_evaluating(expr, target, linkage);
+	if (isVar(expr))
+		return compile_variable(expr, target, linkage, ct_env);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+			return compile_quoted(expr, target, linkage);
+		case LOAD_FORM:
+			return compile_load(expr, target, linkage);
+		case LAMBDA_FORM:
+			return compile_lambda(expr, target, linkage, ct_env);
+		case BEGIN_FORM:
+			return compile_sequence(GETLIST(beginActions(expr)), target, linkage, ct_env);
+		case ASS_FORM:
+			return compile_assignment(expr, target, linkage, SET_VAR, ct_env);
+		case DEF_FORM:
+			return compile_assignment(expr, target, linkage, DEFINE_VAR, ct_env);
+		case IF_FORM:
+			return compile_if(expr, target, linkage, ct_env);
+		case GLOBAL_FORM:
+			return compile_variable(globalName(expr), target, linkage, ct_env);
+		default:
+			return compile_application(expr, target, linkage, ct_env);
+	}
+}
+
+Seq compile_self_evaluating(Obj expr, Reg target, Linkage linkage) {
+	Node* assign = make_node(ASSIGN_CONST, target, target, expr, NO_LABEL);
+	return end_with_linkage(linkage,
+				make_seq(0, REGBIT(target), assign));
+}
+
+Seq compile_quoted(Obj expr, Reg target, Linkage linkage) {
+	Node* assign = make_node(ASSIGN_CONST, target, target, quotedText(expr), NO_LABEL);
+	return end_with_linkage(linkage,
+				make_seq(0, REGBIT(target), assign));
+}
+
+Seq compile_load(Obj expr, Reg target, Linkage linkage) {
+	Node* load = make_node(LOAD_FILE, target, target, expr, NO_LABEL);
+	return end_with_linkage(linkage,
+				make_seq(0, REGBIT(target), load));
+}
+
+Seq compile_variable(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env) {
+	int depth = 0, offset = 0;
+	Node* lookup;
+
+	switch (find_variable(GETNAME(expr), ct_env, &depth, &offset)) {
+		case LEXICAL_ADDR:
+			lookup = make_node(LEXICAL_LOOKUP, target, ENV_REG, expr, NO_LABEL);
+			set_address(lookup, depth, offset);
+			break;
+		default:
+			lookup = make_node(GLOBAL_LOOKUP, target, ENV_REG, expr, NO_LABEL);
+	}
+
+	return end_with_linkage(linkage,
+				make_seq(ENV, REGBIT(target), lookup));
+}
+
+// set! and define (op is SET_VAR or DEFINE_VAR)
+Seq compile_assignment(Obj expr, Reg target, Linkage linkage, Op op, CtFrame* ct_env) {
+	Obj var = assVar(expr);
+	Seq get_value_code = compile(assVal(expr), VAL_REG, NEXT, ct_env);
+
+	// an internal define has a slot like any other local
+	int depth = 0, offset = 0;
+	Address address = find_variable(GETNAME(var), ct_env, &depth, &offset);
+
+	if (address == LEXICAL_ADDR)
+		op = LEXICAL_SET;
+	else if (op == SET_VAR)
+		op = GLOBAL_SET;
+
+	Node* perform = make_node(op, VAL_REG, VAL_REG, var, NO_LABEL);
+	set_address(perform, depth, offset);
+	int modifies = 0;
+
+	// leave the value in the target, as the evaluator does
+	if (target != VAL_REG) {
+		chain(perform, make_node(ASSIGN_REG, target, VAL_REG, NO_OBJ, NO_LABEL));
+		modifies = REGBIT(target);
+	}
+
+	return end_with_linkage(linkage,
+				preserving(ENV,
+					get_value_code,
+					make_seq(ENV | VAL, modifies, perform)));
+}
+
+Seq compile_if(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env) {
+	int t_branch = make_label();
+	int f_branch = make_label();
+	int after_if = make_label();
+
+	Linkage consequent_linkage = linkage == NEXT ? after_if : linkage;
+
+	Seq p_code = compile(ifTest(expr), VAL_REG, NEXT, ct_env);
+	Seq c_code = compile(ifThen(expr), target, consequent_linkage, ct_env);
+	Seq a_code = CDDDR(GETLIST(expr)) ?
+		compile(ifElse(expr), target, linkage, ct_env) :
+		compile_self_evaluating(NUMOBJ(0), target, linkage);
+
+	Node* test =
+		chain(make_node(TEST_FALSE, VAL_REG, VAL_REG, NO_OBJ, NO_LABEL),
+			make_node(BRANCH, VAL_REG, VAL_REG, NO_OBJ, f_branch));
+
+	Seq branches =
+		parallel(append_seqs(label_seq(t_branch), c_code),
+				append_seqs(label_seq(f_branch), a_code));
+
+	return preserving(ENV | CONT,
+				p_code,
+				append_seqs(
+					append_seqs(make_seq(VAL, 0, test), branches),
+					label_seq(after_if)));
+}
+
+Seq compile_sequence(List* seq, Reg target, Linkage linkage, CtFrame* ct_env) {
+	if (seq == NULL)
+		return compile_linkage(linkage);
+
+	if (CDR(seq) == NULL)
+		return compile(CAR(seq), target, linkage, ct_env);
+
+	Seq first = compile(CAR(seq), target, NEXT, ct_env);
+	Seq rest = compile_sequence(CDR(seq), target, linkage, ct_env);
+
+	return preserving(ENV | CONT, first, rest);
+}
+
+Seq compile_lambda(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env) {
+	int proc_entry = make_label();
+	int after_lambda = make_label();
+
+	Linkage lambda_linkage = linkage == NEXT ? after_lambda : linkage;
+
+	Node* make_proc = make_node(MAKE_COMPILED, target, ENV_REG, expr, proc_entry);
+
+	Seq code = end_with_linkage(lambda_linkage,
+					make_seq(ENV, REGBIT(target), make_proc));
+
+	return append_seqs(
+				tack_on(code, compile_lambda_body(expr, proc_entry, ct_env)),
+				label_seq(after_lambda));
+}
+
+// the frame has the params, then the internal defines
+// (EXTEND_ENV's offset is the number of params)
+Seq compile_lambda_body(Obj expr, int proc_entry, CtFrame* ct_env) {
+	List* params = GETLIST(lambdaParams(expr));
+	List* vars = append_lists(params, GETLIST(lambdaLocals(expr)));
+
+	CtFrame frame = {
+		.vars = vars,
+		.enclosure = ct_env
+	};
+
+	Seq body_code = compile_sequence(GETLIST(lambdaBody(expr)), VAL_REG, RETURN, &frame);
+
+	Node* extend = make_node(EXTEND_ENV, ENV_REG, ARGLIST_REG, LISTOBJ(vars), NO_LABEL);
+	set_address(extend, 0, listLength(params));
+
+	Node* entry =
+		chain(make_node(LABEL_MARK, VAL_REG, VAL_REG, NO_OBJ, proc_entry),
+			chain(make_node(COMPILED_ENV, ENV_REG, FUNC_REG, NO_OBJ, NO_LABEL),
+				extend));
+
+	return append_seqs(
+				make_seq(ENV | FUNC | ARGLIST, ENV, entry),
+				body_code);
+}
+
+Seq compile_application(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env) {
+	Seq proc_code = compile(getFunc(expr), FUNC_REG, NEXT, ct_env);
+
+	int count = 0;
+	List* args;
+
+	for (args = GETLIST(getArgs(expr)); args; args = CDR(args))
+		count++;
+
+	Seq* operand_codes = malloc(count * sizeof(Seq));
+
+	int i = 0;
+	for (args = GETLIST(getArgs(expr)); args; args = CDR(args))
+		operand_codes[i++] = compile(CAR(args), VAL_REG, NEXT, ct_env);
+
+	Seq arglist_code = construct_arglist(operand_codes, count);
+	free(operand_codes);
+
+	return preserving(ENV | CONT,
+				proc_code,
+				preserving(FUNC | CONT,
+					arglist_code,
+					compile_procedure_call(target, linkage)));
+}
+
+/* operands are evaluated last to first, as in SICP,
+	but each value goes straight into its own slot
+	of an argument vector allocated for count args
+	(set_address puts the size or slot in offset) */
+
+Seq construct_arglist(Seq* operand_codes, int count) {
+	Node* make = make_node(MAKE_ARGS, ARGLIST_REG, ARGLIST_REG, NO_OBJ, NO_LABEL);
+	set_address(make, 0, count);
+
+	if (count == 0)
+		return make_seq(0, ARGLIST, make);
+
+	Node* set = make_node(SET_ARG, ARGLIST_REG, VAL_REG, NO_OBJ, NO_LABEL);
+	set_address(set, 0, count - 1);
+	Seq last_arg_code =
+		append_seqs(operand_codes[count - 1],
+			make_seq(VAL, ARGLIST, chain(make, set)));
+
+	if (count == 1)
+		return last_arg_code;
+
+	// code-to-get-rest-args, built from the inside out
+	Seq rest_args_code = empty_seq();
+
+	for (int i = 0; i < count - 1; i++) {
+		Node* set = make_node(SET_ARG, ARGLIST_REG, VAL_REG, NO_OBJ, NO_LABEL);
+		set_address(set, 0, i);
+		Seq next_arg_code =
+			preserving(ARGLIST,
+				operand_codes[i],
+				make_seq(VAL | ARGLIST, 0, set));
+
+		rest_args_code = i == 0 ?
+			next_arg_code :
+			preserving(ENV, next_arg_code, rest_args_code);
+	}
+
+	return preserving(ENV, last_arg_code, rest_args_code);
+}
+
+Seq compile_procedure_call(Reg target, Linkage linkage) {
+	int primitive_branch = make_label();
+	int compiled_branch = make_label();
+	int after_call = make_label();
+
+	Linkage compiled_linkage = linkage == NEXT ? after_call : linkage;
+
+	Node* tests =
+		chain(make_node(TEST_PRIM, FUNC_REG, FUNC_REG, NO_OBJ, NO_LABEL),
+			chain(make_node(BRANCH, FUNC_REG, FUNC_REG, NO_OBJ, primitive_branch),
+				chain(make_node(TEST_COMPILED, FUNC_REG, FUNC_REG, NO_OBJ, NO_LABEL),
+					make_node(BRANCH, FUNC_REG, FUNC_REG, NO_OBJ, compiled_branch))));
+
+	Seq compound_code = compile_proc_appl(target, compiled_linkage, APPLY_INTERP);
+
+	Seq compiled_code =
+		append_seqs(label_seq(compiled_branch),
+			compile_proc_appl(target, compiled_linkage, GOTO_ENTRY));
+
+	Node* apply = make_node(APPLY_PRIM, target, FUNC_REG, NO_OBJ, NO_LABEL);
+	Seq primitive_code =
+		append_seqs(label_seq(primitive_branch),
+			end_with_linkage(linkage,
+				make_seq(FUNC | ARGLIST, REGBIT(target), apply)));
+
+	return append_seqs(
+				append_seqs(make_seq(FUNC, 0, tests),
+					parallel(compound_code,
+						parallel(compiled_code, primitive_code))),
+				label_seq(after_call));
+}
+
+/* call is GOTO_ENTRY for compiled procedures
+	and APPLY_INTERP for compound ones */
+
+Seq compile_proc_appl(Reg target, Linkage linkage, Op call) {
+	Node* jump = make_node(call, CONT_REG, FUNC_REG, NO_OBJ, NO_LABEL);
+
+	if (target == VAL_REG && linkage != RETURN) {
+		Node* code =
+			chain(make_node(ASSIGN_LABEL, CONT_REG, CONT_REG, NO_OBJ, linkage),
+				jump);
+		return make_seq(FUNC, ALL_REGS, code);
+	}
+
+	if (target != VAL_REG && linkage != RETURN) {
+		int proc_return = make_label();
+		Node* code =
+			chain(make_node(ASSIGN_LABEL, CONT_REG, CONT_REG, NO_OBJ, proc_return),
+				chain(jump,
+					chain(make_node(LABEL_MARK, VAL_REG, VAL_REG, NO_OBJ, proc_return),
+						chain(make_node(ASSIGN_REG, target, VAL_REG, NO_OBJ, NO_LABEL),
+							make_node(GOTO_LABEL, VAL_REG, VAL_REG, NO_OBJ, linkage)))));
+		return make_seq(FUNC, ALL_REGS, code);
+	}
+
+	if (target == VAL_REG && linkage == RETURN)
+		return make_seq(FUNC | CONT, ALL_REGS, jump);
+
+	printf("compile: return linkage, target not val!\n");
+	exit(1);
+}
+
+/* lexical addressing */
+
+Address find_variable(Symbol* var, CtFrame* ct_env, int* depth, int* offset) {
+	*depth = 0;
+
+	for (CtFrame* frame = ct_env; frame; frame = frame->enclosure) {
+		*offset = 0;
+		for (List* vars = frame->vars; vars; vars = CDR(vars)) {
+			if (GETNAME(CAR(vars)) == var)
+				return LEXICAL_ADDR;
+			(*offset)++;
+		}
+
+		(*depth)++;
+	}
+
+	return GLOBAL_ADDR;
+}
+
+// a copy of front, with back as its tail
+List* append_lists(List* front, List* back) {
+	if (front == NULL)
+		return back;
+	return makeList(CAR(front), append_lists(CDR(front), back));
+}
+
+void set_address(Node* node, int depth, int offset) {
+	node->instr.depth = depth;
+	node->instr.offset = offset;
+}
+
+/* linkage */
+
+Seq compile_linkage(Linkage linkage) {
+	if (linkage == RETURN)
+		return make_seq(CONT, 0,
+				make_node(GOTO_REG, CONT_REG, CONT_REG, NO_OBJ, NO_LABEL));
+
+	if (linkage == NEXT)
+		return empty_seq();
+
+	return make_seq(0, 0,
+			make_node(GOTO_LABEL, VAL_REG, VAL_REG, NO_OBJ, linkage));
+}
+
+Seq end_with_linkage(Linkage linkage, Seq seq) {
+	return preserving(CONT, seq, compile_linkage(linkage));
+}
+
+/* combining instruction sequences */
+
+Seq empty_seq(void) {
+	Seq seq = { .needs = 0, .modifies = 0, .head = NULL, .tail = NULL };
+	return seq;
+}
+
+Seq make_seq(int needs, int modifies, Node* node) {
+	Seq seq = { .needs = needs, .modifies = modifies, .head = node, .tail = node };
+	while (seq.tail && seq.tail->next)
+		seq.tail = seq.tail->next;
+	return seq;
+}
+
+Seq label_seq(int label) {
+	return make_seq(0, 0,
+			make_node(LABEL_MARK, VAL_REG, VAL_REG, NO_OBJ, label));
+}
+
+// splices seq2 onto the end of seq1
+Seq link_seqs(int needs, int modifies, Seq seq1, Seq seq2) {
+	Seq seq = { .needs = needs, .modifies = modifies };
+
+	if (seq1.head == NULL) {
+		seq.head = seq2.head;
+		seq.tail = seq2.tail;
+	}
+	else if (seq2.head == NULL) {
+		seq.head = seq1.head;
+		seq.tail = seq1.tail;
+	}
+	else {
+		seq1.tail->next = seq2.head;
+		seq.head = seq1.head;
+		seq.tail = seq2.tail;
+	}
+
+	return seq;
+}
+
+Seq append_seqs(Seq seq1, Seq seq2) {
+	return link_seqs(
+			seq1.needs | (seq2.needs & ~seq1.modifies),
+			seq1.modifies | seq2.modifies,
+			seq1, seq2);
+}
+
+Seq preserving(int regs, Seq seq1, Seq seq2) {
+	for (Reg reg = 0; reg < reg_count; reg++) {
+		int bit = REGBIT(reg);
+
+		if (!(regs & bit) ||
+			!(seq2.needs & bit) ||
+			!(seq1.modifies & bit))
+				continue;
+
+		Seq save = make_seq(0, 0, make_node(SAVE, reg, reg, NO_OBJ, NO_LABEL));
+		Seq restore = make_seq(0, 0, make_node(RESTORE, reg, reg, NO_OBJ, NO_LABEL));
+
+		seq1 = link_seqs(
+				seq1.needs | bit,
+				seq1.modifies & ~bit,
+				link_seqs(0, 0, save, seq1),
+				restore);
+	}
+
+	return append_seqs(seq1, seq2);
+}
+
+Seq tack_on(Seq seq, Seq body) {
+	return link_seqs(seq.needs, seq.modifies, seq, body);
+}
+
+Seq parallel(Seq seq1, Seq seq2) {
+	return link_seqs(
+			seq1.needs | seq2.needs,
+			seq1.modifies | seq2.modifies,
+			seq1, seq2);
+}
+
+Node* make_node(Op op, Reg target, Reg source, Obj obj, int label) {
+	Node* node = malloc(sizeof(Node));
+	node->instr.op = op;
+	node->instr.target = target;
+	node->instr.source = source;
+	node->instr.obj = obj;
+	node->instr.label = NULL;
+	node->instr.depth = 0;
+	node->instr.offset = 0;
+	node->label = label;
+	node->next = NULL;
+	return node;
+}
+
+// links second onto the end of first
+Node* chain(Node* first, Node* second) {
+	Node* last = first;
+	while (last->next)
+		last = last->next;
+	last->next = second;
+	return first;
+}
+
+int make_label(void) {
+	return label_counter++;
+}
+
+/* assembly */
+
+Instr* assemble(Seq seq) {
+	int length = 0;
+	int* labels = malloc((label_counter + 1) * sizeof(int));
+
+	// find the address of each label
+	for (Node* node = seq.head; node; node = node->next) {
+		if (node->instr.op == LABEL_MARK)
+			labels[node->label] = length;
+		else
+			length++;
+	}
+
+	// the extra instruction is a return, in case
+	// a label falls at the very end
+	Instr* code = malloc((length + 1) * sizeof(Instr));
+	Instr* instr = code;
+
+	Node* node = seq.head;
+	while (node) {
+		if (node->instr.op != LABEL_MARK) {
+			*instr = node->instr;
+			if (hasLabel(instr->op))
+				instr->label = code + labels[node->label];
+			instr++;
+		}
+		Node* temp = node;
+		node = node->next;
+		free(temp);
+	}
+
+	// (all of it, since an image writes it out as is)
+	*instr = (Instr) {
+		.op = GOTO_REG,
+		.target = CONT_REG,
+		.source = CONT_REG,
+		.obj = NO_OBJ
+	};
+
+	free(labels);
+			if (DEBUG) printf("compiled %d instructions\n", length);
+
+	// constants in the code are garbage collector roots
+	register_code(code, length + 1);
+	return code;
+}
+
+bool makesProcedures(Seq seq) {
+	for (Node* node = seq.head; node; node = node->next)
+		if (node->instr.op == MAKE_COMPILED)
+			return true;
+	return false;
+}
+
+bool hasLabel(Op op) {
+	return op == ASSIGN_LABEL ||
+			op == MAKE_COMPILED ||
+			op == BRANCH ||
+			op == GOTO_LABEL;
+}
@@ -0,0 +1,173 @@
+/*
+	COMPILE
+
+	A translation of the compiler from SICP 5.5.
+	compile takes an (analyzed) expression, a target
+	register and a linkage, and returns the sequence
+	of instructions that computes the expression's
+	value into the target and then goes wherever the
+	linkage says: on to the next instruction (NEXT),
+	back to whatever's in cont (RETURN), or to a
+	label.
+
+	As in SICP, every instruction sequence records
+	which registers it needs (reads before writing)
+	and which it modifies, so that preserving only
+	wraps a sequence in save/restore when a later
+	sequence actually needs a register that the
+	earlier one clobbers. That bookkeeping is where
+	all of the savings over the evaluator come from.
+
+	Sequences are linked lists of Nodes that get
+	spliced together destructively (each sequence is
+	only ever used once, so there's no need to copy).
+	Labels are just numbers until assemble lays the
+	finished sequence out in an array of Instrs and
+	turns them into pointers.
+
+	Some differences from SICP:
+
+		-- an if without an alternative gets 0
+		-- set! and define leave the assigned
+			value in the target, as the
+			evaluator does
+		-- procedure calls have a third branch for
+			compound procedures, which are handed
+			off to the evaluator (exercise 5.47)
+
+	Variables are looked up by lexical address,
+	as in SICP 5.5.6. compile carries a compile-time
+	environment (a chain of CtFrames, one for each
+	enclosing lambda) that mirrors the frames the
+	compiled code will actually run in. A variable
+	found there is compiled to a (depth, offset)
+	pair: walk up depth enclosures, then take the
+	offset'th binding of that frame, without looking
+	at any names. A variable that isn't found in any
+	CtFrame has to be global, so it's looked up
+	directly in base_env, skipping every frame in
+	between.
+
+	Internal defines get addresses too. analyze
+	scans them out of each lambda body (see
+	lambdaLocals in llh.c), and EXTEND_ENV makes
+	a slot for each one after the parameters, so a
+	CtFrame's vars are the params followed by the
+	locals, and an internal define is compiled to
+	a LEXICAL_SET like any set!. Only top-level
+	defines go through DEFINE_VAR.
+
+	compile_code is the entry point: it compiles a
+	top-level expression with target val and linkage
+	RETURN and returns the assembled code.
+*/
+
+#ifndef COMPILE_GUARD
+#define COMPILE_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "objects.h"
+#include "flags.h"
+#include "registers.h"
+#include "llh.h"
+#include "vm.h"
+#include "mem.h"
+
+/* linkages (non-negative linkages are labels) */
+
+typedef int Linkage;
+
+#define NEXT -1
+#define RETURN -2
+
+/* compile-time environments */
+
+typedef struct CtFrame CtFrame;
+
+struct CtFrame {
+	List* vars;
+	CtFrame* enclosure;
+};
+
+typedef enum {
+	LEXICAL_ADDR,
+	GLOBAL_ADDR,
+	address_count
+} Address;
+
+/* instruction sequences */
+
+#define REGBIT(R) (1 << (R))
+#define ALL_REGS ((1 << reg_count) - 1)
+
+typedef struct Node Node;
+typedef struct Seq Seq;
+
+struct Node {
+	Instr instr;
+	int label;
+	Node* next;
+};
+
+struct Seq {
+	int needs;
+	int modifies;
+	Node* head;
+	Node* tail;
+};
+
+Instr* compile_code(Obj expr);
+
+/* compilers for each kind of expression */
+
+Seq compile(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env);
+
+Seq compile_self_evaluating(Obj expr, Reg target, Linkage linkage);
+Seq compile_quoted(Obj expr, Reg target, Linkage linkage);
+Seq compile_load(Obj expr, Reg target, Linkage linkage);
+Seq compile_variable(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env);
+Seq compile_assignment(Obj expr, Reg target, Linkage linkage, Op op, CtFrame* ct_env);
+Seq compile_if(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env);
+Seq compile_sequence(List* seq, Reg target, Linkage linkage, CtFrame* ct_env);
+Seq compile_lambda(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env);
+Seq compile_lambda_body(Obj expr, int proc_entry, CtFrame* ct_env);
+Seq compile_application(Obj expr, Reg target, Linkage linkage, CtFrame* ct_env);
+Seq construct_arglist(Seq* operand_codes, int count);
+Seq compile_procedure_call(Reg target, Linkage linkage);
+Seq compile_proc_appl(Reg target, Linkage linkage, Op call);
+
+/* lexical addressing */
+
+Address find_variable(Symbol* var, CtFrame* ct_env, int* depth, int* offset);
+List* append_lists(List* front, List* back);
+void set_address(Node* node, int depth, int offset);
+
+/* linkage */
+
+Seq compile_linkage(Linkage linkage);
+Seq end_with_linkage(Linkage linkage, Seq seq);
+
+/* combining instruction sequences */
+
+Seq empty_seq(void);
+Seq make_seq(int needs, int modifies, Node* node);
+Seq label_seq(int label);
+Seq append_seqs(Seq seq1, Seq seq2);
+Seq preserving(int regs, Seq seq1, Seq seq2);
+Seq tack_on(Seq seq, Seq body);
+Seq parallel(Seq seq1, Seq seq2);
+
+Node* make_node(Op op, Reg target, Reg source, Obj obj, int label);
+Node* chain(Node* first, Node* second);
+int make_label(void);
+
+/* assembly */
+
+Instr* assemble(Seq seq);
+bool hasLabel(Op op);
+bool makesProcedures(Seq seq);
+
+#endif
@@ -1,15 +1,60 @@
 #include "ec_main.h"
 
-int main(void) {
+// any arguments are files to run (see read.c)
+int main(int argc, char** argv) {
 			if (DEBUG) printf("\n%s\n\n", "starting main...");
 
-	print_intro();
+	/* jump targets for the saved labels and the
+		special forms (see DISPATCH in ec_main.h) */
+
+	#ifdef COMPUTED_GOTO
+	static void* label_table[label_count] = {
+		[_DONE] = &&DONE,
+		[_IF_DECIDE] = &&IF_DECIDE,
+		[_DID_ASS_VAL] = &&DID_ASS_VAL,
+		[_DID_DEF_VAL] = &&DID_DEF_VAL,
+		[_DID_FUNC] = &&DID_FUNC,
+		[_ACC_ARG] = &&ACC_ARG,
+		[_DID_LAST_ARG] = &&DID_LAST_ARG,
+		[_SEQ_CONT] = &&SEQ_CONT,
+		[_ALT_SEQ_CONT] = &&ALT_SEQ_CONT,
+		[_RESUME_COMPILED] = &&RESUME_COMPILED,
+	};
+
+	static void* form_table[form_count] = {
+		[QUOTE_FORM] = &&QUOTATION,
+		[LAMBDA_FORM] = &&LAMBDA,
+		[BEGIN_FORM] = &&BEGIN,
+		[ASS_FORM] = &&ASSIGNMENT,
+		[DEF_FORM] = &&DEFINITION,
+		[IF_FORM] = &&IF,
+		[LOAD_FORM] = &&LOAD,
+		[APP_FORM] = &&FUNCTION,
+		[GLOBAL_FORM] = &&GLOBAL_VARIABLE,
+		[FLAT_LAMBDA_FORM] = &&FLAT_LAMBDA,
+		[FREE_FORM] = &&FREE_VARIABLE,
+	};
+	#endif
+
+	int options = set_options(argc, argv);
+
+	if (!BATCH) print_intro();
+
+	initialize_symbols();
+
+	select_scanners();
 
 	base_env = makeBaseEnv();
 
+	if (image_path) loadImage(image_path);
+
+	load_scripts(argc - 1 - options, argv + 1 + options);
+
 	START:
 		initialize_registers();
 		initialize_stack();
+		clearFrames();
+		if (gc_pending) collect_garbage();
 		env = ENVOBJ(base_env);
 				if (INFO) printf("\n\nbase_env: %p\n", base_env);
 				if (INFO) { printf("\n\n@ START\n"); print_info(); }
@@ -18,48 +63,24 @@ int main(void) {
 		if (isQuit(expr)) // move this to read.c
 			goto QUIT;
 		cont = LABELOBJ(_DONE);
+		if (COMPILE)
+			goto COMPILE_EXPR;
 		goto EVAL;
 
+	// a procedure's frame can go as soon as its body has a value
 	CONTINUE:
 				if (INFO) { printf("\n\n@ CONTINUE\n"); print_info(); }
-		if (cont.val.label == _DONE)
-			goto DONE;
-		if (cont.val.label == _IF_DECIDE)
-			goto IF_DECIDE;
-		if (cont.val.label == _DID_ASS_VAL)
-			goto DID_ASS_VAL;
-		if (cont.val.label == _DID_DEF_VAL)
-			goto DID_DEF_VAL;
-		if (cont.val.label == _DID_FUNC)
-			goto DID_FUNC;
-		if (cont.val.label == _ACC_ARG)
-			goto ACC_ARG;
-		if (cont.val.label == _DID_LAST_ARG)
-			goto DID_LAST_ARG;
-		if (cont.val.label == _SEQ_CONT)
-			goto SEQ_CONT;
-		if (cont.val.label == _ALT_SEQ_CONT)
-			goto ALT_SEQ_CONT;
+		popFrames(stack_top + 1);
+		DISPATCH(GETLABEL(cont));
 
 	EVAL:
 				if (INFO) { printf("\n\n@ EVAL\n"); print_info(); }
+		if (gc_pending) collect_garbage();
 		if (isNum(expr))
 			goto NUMBER;
 		if (isVar(expr))
 			goto VARIABLE;
-		if (isQuote(expr))
-			goto QUOTATION;
-		if (isLambda(expr))
-			goto LAMBDA;
-		if (isBegin(expr))
-			goto BEGIN;
-		if (isAss(expr))
-			goto ASSIGNMENT;
-		if (isDef(expr))
-			goto DEFINITION;
-		if (isIf(expr))
-			goto IF;
-		goto FUNCTION;
+		DISPATCH_FORM(formOf(expr));
 
 
 	NUMBER:
@@ -69,15 +90,30 @@ int main(void) {
 
 	VARIABLE:
 				if (INFO) { printf("\n\n@ VARIABLE\n"); print_info(); }
-				if (DEBUG) printf("%s\n", expr.val.name);
+				if (DEBUG) printf("%s\n", GETSTR(expr));
 		val = lookup(expr, env);
-		if (val.tag == DUMMY)
+		if (GETTAG(val) == DUMMY)
+			goto UNBOUND;
+		goto CONTINUE;
+
+	GLOBAL_VARIABLE:
+				if (INFO) { printf("\n\n@ GLOBAL_VARIABLE\n"); print_info(); }
+		val = lookupGlobalRef(expr);
+		if (GETTAG(val) == DUMMY)
 			goto UNBOUND;
 		goto CONTINUE;
 
+	FREE_VARIABLE:
+				if (INFO) { printf("\n\n@ FREE_VARIABLE\n"); print_info(); }
+		val = lookupFreeRef(expr, env);
+		goto CONTINUE;
+
 	UNBOUND:
 				if (INFO) { printf("\n\n@ UNBOUND\n"); print_info(); }
-		printf("\n\nUNBOUND VARIABLE: \"%s\"!\n", expr.val.name);
+		if (isGlobalRef(expr))
+			expr = globalName(expr);
+		printf("\n\nUNBOUND VARIABLE: \"%s\"!\n", GETSTR(expr));
+		error_count++;
 		// clear_stack();
 		// getchar();
 		goto START;
@@ -87,6 +123,12 @@ int main(void) {
 		val = quotedText(expr);
 		goto CONTINUE;
 
+	// the file is read after this form is done (see read.c)
+	LOAD:
+				if (INFO) { printf("\n\n@ LOAD\n"); print_info(); }
+		val = loadFile(expr);
+		goto CONTINUE;
+
 	BEGIN:
 				if (INFO) { printf("\n\n@ BEGIN\n"); print_info(); }
 		unev = beginActions(expr);
@@ -95,9 +137,12 @@ int main(void) {
 
 	LAMBDA:
 				if (INFO) { printf("\n\n@ LAMBDA\n"); print_info(); }
-		unev = lambdaParams(expr);
-		expr = lambdaBody(expr);
-		val = makeFunc(unev, expr, env);
+		val = makeFunc(expr, env);
+		goto CONTINUE;
+
+	FLAT_LAMBDA:
+				if (INFO) { printf("\n\n@ FLAT_LAMBDA\n"); print_info(); }
+		val = makeFlatFunc(expr, env);
 		goto CONTINUE;
 
 	/* if (and other boolean macros) */
@@ -132,7 +177,7 @@ int main(void) {
 
 	/* ass, def */
 
-	#define ASS_DEF_RETURN_VAL MKOBJ(NAME, name, "ok")
+	#define ASS_DEF_RETURN_VAL NAMEOBJ(intern("ok"))
 		
 	// leave ass/def val as return val?
 
@@ -179,24 +224,40 @@ int main(void) {
 
 	/* function application */
 
+	/* constants and variables can't clobber any
+		registers, so they're evaluated on the spot,
+		without saving anything (SICP exercise 5.32) */
+
 	FUNCTION:
 				if (INFO) { printf("\n\n@ FUNCTION\n"); print_info(); }
 		save(cont);
-		save(env);
 		unev = getArgs(expr);
-		save(unev);
 		expr = getFunc(expr);
+		if (isSimple(expr)) {
+			val = simpleValue(expr, env);
+			if (GETTAG(val) == DUMMY)
+				goto UNBOUND;
+			goto GOT_FUNC;
+		}
+		save(env);
+		save(unev);
 		cont = LABELOBJ(_DID_FUNC);
 		goto EVAL;
 
-	#define empty_arglist MKOBJ(LIST, list, NULL)
-
 	DID_FUNC:
 				if (INFO) { printf("\n\n@ DID_FUNC\n"); print_info(); }
 		restore(&unev); // the arguments
 		restore(&env);
-		arglist = empty_arglist; // #definition above
+		// fall through to GOT_FUNC
+
+	/* the arglist is a vector with a slot for each
+		operand (see makeArgs in env.c), and room for
+		the internal defines of the procedure, since
+		it's going to be the procedure's frame */
+
+	GOT_FUNC:
 		func = val;
+		arglist = makeArgs(countArgs(unev) + localCount(func));
 		if (noArgs(unev)) // (null? unev)
 			goto APPLY;
 		save(func);
@@ -204,8 +265,10 @@ int main(void) {
 
 	ARG_LOOP:
 				if (INFO) { printf("\n\n@ ARG_LOOP\n"); print_info(); }
-		save(arglist);
 		expr = firstArg(unev); // (car unev)
+		if (isSimple(expr))
+			goto SIMPLE_ARG;
+		save(arglist);
 		if (isLastArg(unev)) // (null? (cdr unev))
 			goto LAST_ARG;
 		save(env);
@@ -218,10 +281,23 @@ int main(void) {
 		restore(&unev);
 		restore(&env);
 		restore(&arglist);
-		arglist = adjoinArg(val, arglist); // append val to end of arglist
+		arglist = adjoinArg(val, arglist); // fill the next slot
 		unev = restArgs(unev); // (cdr unev)
 		goto ARG_LOOP;
 
+	SIMPLE_ARG:
+				if (INFO) { printf("\n\n@ SIMPLE_ARG\n"); print_info(); }
+		val = simpleValue(expr, env);
+		if (GETTAG(val) == DUMMY)
+			goto UNBOUND;
+		arglist = adjoinArg(val, arglist);
+		if (isLastArg(unev)) {
+			restore(&func);
+			goto APPLY;
+		}
+		unev = restArgs(unev);
+		goto ARG_LOOP;
+
 	LAST_ARG:
 		if (INFO) { printf("\n\n@ LAST_ARG\n"); print_info(); }
 		cont = LABELOBJ(_DID_LAST_ARG);
@@ -243,19 +319,30 @@ int main(void) {
 			goto APPLY_PRIMITIVE;
 		if (isCompound(func))
 			goto APPLY_COMPOUND;
+		if (isCompiled(func))
+			goto APPLY_COMPILED;
 
 	APPLY_PRIMITIVE:
 				if (INFO) { printf("\n\n@ APPLY_PRIMITIVE\n"); print_info(); }
 		val = applyPrimitive(func, arglist);
+		releaseArgs(arglist);
+		arglist = LISTOBJ(NULL);
 		restore(&cont);
 		goto CONTINUE;
 
 	// only place env is assigned a new value
 	APPLY_COMPOUND:
 				if (INFO) { printf("\n\n@ APPLY_COMPOUND\n"); print_info(); }
-		unev = funcParams(func);
-		env = funcEnv(func);
-		env = extendEnv(unev, arglist, env);
+		if (isSelfTailCall(func, env, arglist))
+			env = reuseFrame(env, arglist);
+		else {
+			popFrames(stack_top);
+			env = extendClosureEnv(func, arglist);
+			if (GETTAG(env) == DUMMY)
+				goto START;
+			pushFrame(env);
+		}
+		arglist = LISTOBJ(NULL);
 		unev = funcBody(func);
 		if (TAIL)
 			goto SEQUENCE;
@@ -310,6 +397,45 @@ int main(void) {
 		goto CONTINUE;
 
 
+	/************************/
+
+	/* compiled code (see compile.c and vm.c) */
+
+	COMPILE_EXPR:
+				if (INFO) { printf("\n\n@ COMPILE_EXPR\n"); print_info(); }
+		pc = compile_code(expr);
+		goto EXECUTE;
+
+	APPLY_COMPILED:
+				if (INFO) { printf("\n\n@ APPLY_COMPILED\n"); print_info(); }
+		restore(&cont);
+		popFrames(stack_top + 1);
+		pc = compiledEntry(func);
+		goto EXECUTE;
+
+	// an interpreted procedure returning to compiled code
+	RESUME_COMPILED:
+				if (INFO) { printf("\n\n@ RESUME_COMPILED\n"); print_info(); }
+		restore(&cont);
+		pc = GETCODE(cont);
+		goto EXECUTE;
+
+	EXECUTE:
+				if (INFO) { printf("\n\n@ EXECUTE\n"); print_info(); }
+		switch (execute()) {
+			case VM_RETURN:
+				goto CONTINUE;
+			case VM_APPLY:
+				goto APPLY;
+			case VM_UNBOUND:
+				goto UNBOUND;
+			case VM_ERROR:
+				goto START;
+			default:
+				goto QUIT;
+		}
+
+
 	/************************/
 
 	DONE:
@@ -318,11 +444,13 @@ int main(void) {
 				if (STATS) print_stats();
 		goto START;
 
+	// the output buffer is flushed on the way out
 	QUIT:
+				if (dump_path) dumpImage(dump_path);
 				free_memory();
-				printf("\n%s\n", "exiting lispinc...");
-				printf("Byeeeeee!\n\n");
-				return 0;
+				if (!BATCH) printf("\n%s\n", "exiting lispinc...");
+				if (!BATCH) printf("Byeeeeee!\n\n");
+				return error_count ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 
@@ -53,5 +53,74 @@
 #include "llh.h"
 #include "print.h"
 #include "mem.h"
+#include "symbol.h"
+#include "compile.h"
+#include "vm.h"
+#include "image.h"
+
+/*
+	DISPATCH
+
+	SICP's toy assembly lets labels be stored in
+	registers and jumped to directly with
+	(goto (reg continue)). C doesn't have first-class
+	labels, but GCC (and clang) do as an extension:
+	&&LABEL is the address of a label and goto *ptr
+	jumps to it. When that's available, CONTINUE looks
+	up the saved Label in a table of label addresses
+	and makes a single indirect jump. Otherwise it
+	falls back to a switch, which the compiler can
+	still turn into a jump table.
+
+	EVAL dispatches the same way on the Form
+	that analyze.c has cached at the head of each
+	special form (DISPATCH_FORM).
+
+	Compile with -DNO_COMPUTED_GOTO to force the
+	portable version.
+*/
+
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define COMPUTED_GOTO
+#endif
+
+#ifdef COMPUTED_GOTO
+
+#define DISPATCH(LABEL) goto *label_table[LABEL]
+#define DISPATCH_FORM(FORM) goto *form_table[FORM]
+
+#else
+
+#define DISPATCH(LABEL) \
+	switch (LABEL) { \
+		case _DONE: goto DONE; \
+		case _IF_DECIDE: goto IF_DECIDE; \
+		case _DID_ASS_VAL: goto DID_ASS_VAL; \
+		case _DID_DEF_VAL: goto DID_DEF_VAL; \
+		case _DID_FUNC: goto DID_FUNC; \
+		case _ACC_ARG: goto ACC_ARG; \
+		case _DID_LAST_ARG: goto DID_LAST_ARG; \
+		case _SEQ_CONT: goto SEQ_CONT; \
+		case _ALT_SEQ_CONT: goto ALT_SEQ_CONT; \
+		case _RESUME_COMPILED: goto RESUME_COMPILED; \
+		default: break; \
+	}
+
+#define DISPATCH_FORM(FORM) \
+	switch (FORM) { \
+		case QUOTE_FORM: goto QUOTATION; \
+		case LAMBDA_FORM: goto LAMBDA; \
+		case BEGIN_FORM: goto BEGIN; \
+		case ASS_FORM: goto ASSIGNMENT; \
+		case DEF_FORM: goto DEFINITION; \
+		case IF_FORM: goto IF; \
+		case LOAD_FORM: goto LOAD; \
+		case GLOBAL_FORM: goto GLOBAL_VARIABLE; \
+		case FLAT_LAMBDA_FORM: goto FLAT_LAMBDA; \
+		case FREE_FORM: goto FREE_VARIABLE; \
+		default: goto FUNCTION; \
+	}
+
+#endif
 
 #endif
\ No newline at end of file
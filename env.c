@@ -17,24 +17,196 @@ Env* makeBaseEnv(void) {
 
 	Env* env = makeEnv(primitives, NULL);
 
-	append_to_envs(env);
+	index_globals(primitives, INITIAL_GLOBAL_CAPACITY);
 
 	return env;
 }
 
-// returns new env obj with vars bound to vals
-Obj extendEnv(Obj vars_obj, Obj vals_obj, Obj base_env_obj) {
+// names the slots of the argument vector after vars (the
+// first param_count of them are params, the rest internal
+// defines) and hangs it off base_env, so the arglist
+// becomes the new env
+Obj extendEnv(Obj vars_obj, int param_count, Obj arglist, Obj base_env_obj) {
 
-	List* vars = vars_obj.val.list;
-	List* vals = vals_obj.val.list;
-	Env* base_env = base_env_obj.val.env;
+	List* vars = GETLIST(vars_obj);
+	Env* ext_env = GETENV(arglist);
+	Frame* frame = ext_env->frame;
 
-	Frame* frame = makeFrame(vars, vals);
-	Env* ext_env = makeEnv(frame, base_env);
+	int i;
+	for (i = 0; i < param_count && i < frame->count; i++) {
+		frame->bindings[i].key = GETNAME(vars->car);
+		vars = vars->cdr;
+	}
+
+	// the body can't run on a frame that's the wrong size
+	if (i < param_count || i < frame->count) {
+		printf("wrong number of arguments -- extendEnv\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
+
+	int size = frame->count + listLength(vars);
+	if (frame->size < size)
+		ext_env->frame = frame = resizeFrame(frame, size);
+
+	for (; vars; vars = vars->cdr)
+		add_local(frame, GETNAME(vars->car));
+
+	ext_env->enclosure = GETENV(base_env_obj);
+
+	return arglist;
+}
+
+// the same, for a closure (whose params are already an array)
+Obj extendClosureEnv(Obj func, Obj arglist) {
+
+	Closure* closure = GETCLOSURE(func);
+	Env* ext_env = GETENV(arglist);
+	Frame* frame = ext_env->frame;
+
+	int count = closure->param_count;
+
+	if (count != frame->count) {
+		printf("wrong number of arguments -- extendEnv\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
+
+	for (int i = 0; i < count; i++)
+		frame->bindings[i].key = closure->params[i];
+
+	// the arglist has room already, unless compiled code made it
+	int size = count + closure->local_count;
+	if (frame->size < size)
+		ext_env->frame = frame = resizeFrame(frame, size);
+
+	for (int i = 0; i < closure->local_count; i++)
+		add_local(frame, closure->params[closure->param_count + i]);
+
+	ext_env->enclosure = closure->env;
+	ext_env->depth = stack_top;
+
+	return arglist;
+}
+
+/*
+	a tail call leaves the stack exactly as deep as it
+	was when the caller's body started (cont is on top),
+	and the body's value turns up with the stack one
+	below that (cont has been popped). anywhere else in
+	the body, something (at least env) has been saved on
+	top of it. so a frame is dead when the stack is back
+	at its depth and the body is making a tail call, or
+	one below it and the body has its value, unless a
+	lambda has captured the frame. (with TAIL off, every
+	call saves env, so only the second case happens.)
+*/
+
+/* the frame stack: every procedure frame (made here by
+	extendClosureEnv, or by EXTEND_ENV in vm.c), in the
+	order they were made, so that dead ones can be released
+	in LIFO order as the stack unwinds (env might not point
+	to a frame anymore when it dies) */
+
+Env** frame_stack = NULL;
+int frame_top = 0;
+int frame_stack_size = 0;
+
+void pushFrame(Obj env_obj) {
+	if (frame_top == frame_stack_size) {
+		frame_stack_size = frame_stack_size ? 2 * frame_stack_size : INITIAL_STACK_SIZE;
+		frame_stack = realloc(frame_stack, frame_stack_size * sizeof(Env*));
+	}
+	frame_stack[frame_top++] = GETENV(env_obj);
+}
+
+// releases every frame made at depth or deeper (captured
+// ones are just dropped, and left to the collector). the
+// env register might still point at the last one, so it's
+// pointed somewhere harmless
+void popFrames(int depth) {
+	while (frame_top && frame_stack[frame_top - 1]->depth >= depth) {
+		Env* dead = frame_stack[--frame_top];
+		if (dead->captured)
+			continue;
+		if (GETENV(env) == dead)
+			env = ENVOBJ(base_env);
+		releaseArgs(ENVOBJ(dead));
+	}
+}
+
+// after an error, whatever's left is the collector's problem
+void clearFrames(void) {
+	frame_top = 0;
+}
+
+// if func is a closure over the same env as a dead frame,
+// with the same params and defines, the frame can take the
+// new args
+bool isSelfTailCall(Obj func, Obj env_obj, Obj arglist) {
+	Closure* closure = GETCLOSURE(func);
+	Env* env = GETENV(env_obj);
+
+	if (env->enclosure != closure->env ||
+			env->depth != stack_top || env->captured)
+		return false;
 
-	append_to_envs(ext_env);
+	Frame* frame = env->frame;
+	Frame* args = GETENV(arglist)->frame;
+
+	int size = closure->param_count + closure->local_count;
+
+	if (args->count != closure->param_count || frame->count != size)
+		return false;
+
+	for (int i = 0; i < size; i++)
+		if (frame->bindings[i].key != closure->params[i])
+			return false;
+
+	return true;
+}
+
+// overwrites the current frame with the new args (internal
+// defines go back to unassigned, since the body will make
+// them again)
+Obj reuseFrame(Obj env_obj, Obj arglist) {
+	Frame* frame = GETENV(env_obj)->frame;
+	Frame* args = GETENV(arglist)->frame;
+
+	for (int i = 0; i < args->count; i++)
+		frame->bindings[i].val = ARG(args, i);
+	for (int i = args->count; i < frame->count; i++)
+		frame->bindings[i].val = UNINITOBJ;
 
-	return ENVOBJ(ext_env);
+	releaseArgs(arglist);
+	return env_obj;
+}
+
+/* argument vectors */
+
+// an empty arglist with room for size args
+Obj makeArgs(int size) {
+	return ENVOBJ(makeEnv(allocFrame(size), NULL));
+}
+
+// for filling an arglist out of order (compiled code
+// fills it last to first); skipped slots are UNINIT
+// until they're set
+void setArg(Obj arglist, int index, Obj val) {
+	Frame* args = GETENV(arglist)->frame;
+
+	while (args->count <= index)
+		ARG(args, args->count++) = UNINITOBJ;
+
+	ARG(args, index) = val;
+}
+
+// only for arglists nobody else can see (the ones
+// applied to primitives)
+void releaseArgs(Obj arglist) {
+	Env* args = GETENV(arglist);
+	release(args->frame);
+	release(args);
 }
 
 
@@ -42,83 +214,258 @@ Obj extendEnv(Obj vars_obj, Obj vals_obj, Obj base_env_obj) {
 
 // returns val bound to var in env
 Obj lookup(Obj var_obj, Obj env_obj) {
-			if (DEBUG) printf("looking up \"%s\"\n", var_obj.val.name);
+			if (DEBUG) printf("looking up \"%s\"\n", GETSTR(var_obj));
 
-	char* var = var_obj.val.name;
-	Env* env = env_obj.val.env;
+	Symbol* var = GETNAME(var_obj);
+	Env* env = GETENV(env_obj);
 
 	return lookup_in_env(var, env);
 }
 
+// the value of an expr that isSimple (DUMMY if unbound)
+Obj simpleValue(Obj expr, Obj env_obj) {
+	if (isNum(expr))
+		return expr;
+	if (isVar(expr))
+		return lookup(expr, env_obj);
+	if (isGlobalRef(expr))
+		return lookupGlobalRef(expr);
+	if (isFreeRef(expr))
+		return lookupFreeRef(expr, env_obj);
+	return quotedText(expr);
+}
+
+// a free variable of a flat closure is a slot in the closure's
+// own env, which is the enclosure of the frame of the call
+Obj lookupFreeRef(Obj ref, Obj env_obj) {
+	Frame* free = GETENV(env_obj)->enclosure->frame;
+	return free->bindings[freeIndex(ref)].val;
+}
+
 // lookup helpers
 
-Obj lookup_in_env(char* var, Env* env) { // lookup in env
+Obj lookup_in_env(Symbol* var, Env* env) { // lookup in env
 			if (DEBUG) printf("%s\n", "looking up in env...");
 	if (env == NULL) {
 			if (DEBUG) printf("%s\n", "null env, returning DUMMY");
 		return DUMMYOBJ;
 	}
 
+	if (env == base_env)
+		return lookup_global(var);
+
 	Frame* frame = env->frame;
 	Obj checkFrame = lookup_in_frame(var, frame);
 
-	if (checkFrame.tag != DUMMY)
+	// an internal define that hasn't happened yet
+	if (GETTAG(checkFrame) == UNINIT)
+		return DUMMYOBJ;
+
+	if (GETTAG(checkFrame) != DUMMY)
 		return checkFrame;
 	else
 		return lookup_in_env(var, env->enclosure);
 }
 
-Obj lookup_in_frame(char* var, Frame* frame) { // helper for lookup
+Obj lookup_in_frame(Symbol* var, Frame* frame) { // helper for lookup
 			if (DEBUG) printf("%s\n", "looking up in frame...");
-	if (frame == NULL)
+
+	// newest bindings are at the end
+	for (int i = frame->count - 1; i >= 0; i--)
+		if (frame->bindings[i].key == var)
+			return frame->bindings[i].val;
+
+	return DUMMYOBJ;
+}
+
+/* lexical addressing */
+
+Obj lexicalLookup(int depth, int offset, Obj env_obj) {
+	return lexical_binding(depth, offset, GETENV(env_obj))->val;
+}
+
+void lexicalSet(int depth, int offset, Obj val_obj, Obj env_obj) {
+	lexical_binding(depth, offset, GETENV(env_obj))->val = val_obj;
+}
+
+Binding* lexical_binding(int depth, int offset, Env* env) {
+	while (depth--)
+		env = env->enclosure;
+
+	return &env->frame->bindings[offset];
+}
+
+/* the global table */
+
+/* slots in an open-addressing table keyed by
+	symbol, each holding the index of a binding
+	in base_env's frame. The indices stay good when
+	the frame grows or the collector moves it. */
+
+int* global_slots;
+int global_capacity;
+
+/* inline caches at reference sites hold a binding
+	index and the version it was found in. Bindings
+	never move or disappear, so in fact only a new
+	global can make a miss turn into a hit, but
+	bumping the version on every new define keeps
+	the caches honest if that ever changes. */
+
+int global_version = 1;
+
+// the slot for var, or the empty slot where it would go
+int* global_slot(Symbol* var, Frame* frame) {
+	unsigned mask = global_capacity - 1;
+	unsigned i = var->hash & mask;
+
+	while (global_slots[i] != EMPTY_SLOT &&
+			frame->bindings[global_slots[i]].key != var)
+		i = (i + 1) & mask;
+
+	return &global_slots[i];
+}
+
+// capacity has to be a power of two
+void index_globals(Frame* frame, int capacity) {
+	free(global_slots);
+	global_capacity = capacity;
+	global_slots = malloc(capacity * sizeof(int));
+	for (int i = 0; i < capacity; i++)
+		global_slots[i] = EMPTY_SLOT;
+
+	for (int i = 0; i < frame->count; i++)
+		*global_slot(frame->bindings[i].key, frame) = i;
+}
+
+Obj lookup_global(Symbol* var) {
+	Frame* frame = base_env->frame;
+	int index = *global_slot(var, frame);
+
+	if (index == EMPTY_SLOT)
 		return DUMMYOBJ;
+	return frame->bindings[index].val;
+}
 
-	char* key = frame->key;
+// index and version are the cache at the reference site
+Obj cachedGlobalLookup(Symbol* var, int* index, int* version) {
+	Frame* frame = base_env->frame;
 
-	if (strcmp(var, key) == 0)
-		return (frame->val);
-	else
-		return lookup_in_frame(var, frame->next);
+	if (*version == global_version)
+		return frame->bindings[*index].val;
+
+	int found = *global_slot(var, frame);
+	if (found == EMPTY_SLOT)
+		return DUMMYOBJ;
+
+	*index = found;
+	*version = global_version;
+	return frame->bindings[found].val;
+}
+
+// ref is a (GLOBAL name index version) from analyze.c
+Obj lookupGlobalRef(Obj ref) {
+	List* index_cell = CDDR(GETLIST(ref));
+	List* version_cell = CDR(index_cell);
+
+	if (GETNUM(CAR(version_cell)) == global_version)
+		return base_env->frame->bindings[GETNUM(CAR(index_cell))].val;
+
+	int index = 0, version = 0;
+	Obj val = cachedGlobalLookup(GETNAME(globalName(ref)), &index, &version);
+	CAR(index_cell) = NUMOBJ(index);
+	CAR(version_cell) = NUMOBJ(version);
+	return val;
+}
+
+// a global define of a bound name just replaces the value
+void define_global(Symbol* var, Obj val_obj) {
+	Frame* frame = base_env->frame;
+	int* slot = global_slot(var, frame);
+
+	if (*slot != EMPTY_SLOT) {
+		frame->bindings[*slot].val = val_obj;
+		return;
+	}
+
+	if (frame->count == frame->size)
+		base_env->frame = frame = growFrame(frame);
+
+	frame->bindings[frame->count].key = var;
+	frame->bindings[frame->count].val = val_obj;
+	*slot = frame->count;
+	frame->count++;
+	global_version++;
+
+	// keep the table at most half full
+	if (2 * frame->count > global_capacity)
+		index_globals(frame, 2 * global_capacity);
 }
 
 /* modify env */
 
-/* adds new var/val binding to env
-(doesn't check for existing binding) */
+/* binds var to val in env. an internal define
+already has a slot in the frame (see analyze.c),
+so it's just filled in; anything else is added
+as a new binding (or replaced, in base_env) */
 void defineVar(Obj var_obj, Obj val_obj, Obj* env_obj) {
 
-	char* var = var_obj.val.name;
-	Env* env = (*env_obj).val.env;
+	Symbol* var = GETNAME(var_obj);
+	Env* env = GETENV(*env_obj);
 
-	Frame* frame = malloc(sizeof(Frame));
-	frame->key = var;
-	frame->val = val_obj;
-	frame->next = env->frame;
-	env->frame = frame;
+	if (env == base_env) {
+		define_global(var, val_obj);
+		return;
+	}
+
+	Frame* frame = env->frame;
+
+	for (int i = frame->count - 1; i >= 0; i--)
+		if (frame->bindings[i].key == var) {
+			frame->bindings[i].val = val_obj;
+			return;
+		}
+
+	if (frame->count == frame->size)
+		env->frame = frame = growFrame(frame);
+
+	frame->bindings[frame->count].key = var;
+	frame->bindings[frame->count].val = val_obj;
+	frame->count++;
 	return;
 }
 
 // sets first occurence of var to val
 void setVar(Obj var_obj, Obj val_obj, Obj env_obj) {
 
-	char* var = var_obj.val.name;
-	Env* env = env_obj.val.env;
+	Symbol* var = GETNAME(var_obj);
+	Env* env = GETENV(env_obj);
 
 	if (env == NULL) {
 		printf("unbound variable -- setVar\n");
+		error_count++;
 		return;
 	}
 
-	Frame* frame = env->frame;
+	if (env == base_env) {
+		Frame* frame = env->frame;
+		int index = *global_slot(var, frame);
+		if (index == EMPTY_SLOT) {
+			printf("unbound variable -- setVar\n");
+			error_count++;
+		}
+		else
+			frame->bindings[index].val = val_obj;
+		return;
+	}
 
-	while (frame != NULL) {
+	Frame* frame = env->frame;
 
-		if (strcmp(var, frame->key) == 0) {
-			frame->val = val_obj;
+	for (int i = frame->count - 1; i >= 0; i--) {
+		if (var == frame->bindings[i].key) {
+			frame->bindings[i].val = val_obj;
 			return;
 		}
-
-		frame = frame->next;
 	}
 
 	Obj enclosure = ENVOBJ(env->enclosure);
@@ -129,33 +476,70 @@ void setVar(Obj var_obj, Obj val_obj, Obj env_obj) {
 /* constructors */
 
 Env* makeEnv(Frame* frame, Env* enclosure) {
-	Env* env = malloc(sizeof(Env));
+	Env* env = allocate(ENV_KIND, sizeof(Env));
 	env->frame = frame;
 	env->enclosure = enclosure;
+	env->depth = -1;
+	env->captured = false;
 	return env;
 }
 
-// zip-like
+// zip-like, with one slot per var
 Frame* makeFrame(List* vars, List* vals) {
-	if (vars == NULL)
-		return NULL;
+	int size = 0;
+	for (List* temp = vars; temp; temp = temp->cdr)
+		size++;
 
-	char* key = vars->car.val.name;
-	Obj val = vals->car;
+	Frame* frame = allocFrame(size);
 
-	Frame* frame = malloc(sizeof(Frame));
-
-	frame->key = key;
-	frame->val = val;
+	for (int i = 0; i < size; i++) {
+		frame->bindings[i].key = GETNAME(vars->car);
+		frame->bindings[i].val = vals->car;
+		vars = vars->cdr;
+		vals = vals->cdr;
+	}
 
-	frame->next = makeFrame(vars->cdr, vals->cdr);
+	frame->count = size;
+	return frame;
+}
 
+Frame* allocFrame(int size) {
+	Frame* frame = allocate(FRAME_KIND,
+						sizeof(Frame) + size * sizeof(Binding));
+	frame->count = 0;
+	frame->size = size;
 	return frame;
 }
 
+Frame* growFrame(Frame* frame) {
+	int size = frame->size * 2;
+	if (size < MIN_FRAME_GROWTH)
+		size = MIN_FRAME_GROWTH;
+
+	return resizeFrame(frame, size);
+}
+
+// the caller has to replace its pointer to frame
+// (frames aren't shared, so the old one is released)
+Frame* resizeFrame(Frame* frame, int size) {
+	Frame* resized = allocFrame(size);
+	memcpy(resized->bindings, frame->bindings,
+			frame->count * sizeof(Binding));
+	resized->count = frame->count;
+	release(frame);
+	return resized;
+}
+
+// a slot for an internal define, unassigned until it runs
+void add_local(Frame* frame, Symbol* var) {
+	frame->bindings[frame->count].key = var;
+	frame->bindings[frame->count].val = UNINITOBJ;
+	frame->count++;
+}
+
 // cons-like (declaration in objects.h)
 List* makeList(Obj car, List* cdr) {
-	List* list = malloc(sizeof(List));
+	List* list = allocate(LIST_KIND, sizeof(List));
 	list->car = car;
 	list->cdr = cdr;
 	return list;
@@ -11,10 +11,28 @@
 	Typewise, an Env is a struct containing 
 	a pointer to another Env (its 'enclosing
 	enviroment' or 'enclosure') and a pointer
-	to a Frame. A Frame is a linked list of
-	key / value pairs. For convenience, both
-	keys and values are wrapped in the Obj
-	type (see objects.h for definitions).
+	to a Frame. A Frame is an array of Bindings
+	(key / value pairs) allocated in one piece,
+	along with the number of bindings in use and
+	the number of slots allocated. A frame made
+	by extendEnv has exactly one slot for each
+	parameter and one for each internal define
+	of the procedure. Keys are Symbols and values are Objs
+	(see objects.h for definitions).
+
+	An arglist is an Env too. makeArgs allocates
+	one with a slot for each operand and no keys or
+	enclosure, and the evaluator fills in the
+	values as the operands are evaluated (adjoinArg
+	in the interpreter, setArg in compiled code).
+	Primitives read their arguments straight out of
+	the frame, and when a compound procedure is
+	applied, extendEnv just writes the parameter
+	names into the keys and sets the enclosure:
+	the arglist is the new env, with nothing
+	consed or copied. (An arglist that's applied
+	to a primitive is garbage right away, so it's
+	released.)
 
 	[ add a diagram here? ]
 
@@ -28,7 +46,32 @@
 	lookup takes two Objs as arguments, the
 	first of type NAME and the second of type
 	ENV. It looks up the name in the env and
-	returns the bound value.
+	returns the bound value. Names are interned
+	(see symbol.c), so keys are compared by pointer.
+
+	lexicalLookup and lexicalSet find a binding by
+	its lexical address: depth enclosures up, offset
+	bindings in. They're only used by compiled code,
+	which knows the shape of its frames in advance.
+	Global references don't need an address at all
+	(see below).
+
+	base_env is different from the other envs: it
+	holds every primitive and every top-level
+	define, so scanning its frame would get slow.
+	Its frame is indexed by an open-addressing
+	hash table (using the hash that symbol.c
+	already computed for each name), and any
+	lookup, define or set that reaches base_env
+	goes through the table. A define of a name
+	that's already global replaces the value
+	instead of adding another binding.
+
+	References that analyze.c or compile.c know to
+	be global also keep an inline cache: the index
+	of the binding they found last time and the
+	global_version at the time. If the version
+	still matches, the lookup is a single load.
 
 	defineVar and setVar each take three Objs as
 	arguments, with the first of type NAME and 
@@ -36,17 +79,58 @@
 	anything.) setVar sets the first occurence
 	of the name in the env to the value (raising
 	an error if the name is unbound), while
-	defineVar adds a new name/value binding to 
-	the topmost frame of the env (it doesn't check 
-	to see if the name is already bound, but because 
-	of the top-down lookup procedure this doesn't 
-	create naming-collision problems).
-
-	extendEnv takes two List Objs (the first being
-	a List of NAME Objs) and an Env Obj and adds
-	a returns a new Env Obj, the frame of which is
-	the two Lists zipped together and the enclosure
-	of which is the first Env.
+	defineVar binds the name in the topmost frame
+	of the env. The internal defines of a procedure
+	are scanned out ahead of time (as in SICP
+	4.1.6; see analyze.c), so the frame already has
+	a slot for the name, unassigned (UNINIT) until
+	the define runs, and a lookup that finds an
+	unassigned slot fails as if the name were
+	unbound. A frame never changes shape once the
+	procedure is entered: the parameters come
+	first, then the internal defines, all at fixed
+	offsets. (A define anywhere else is appended,
+	growing the frame if it's full.)
+
+	extendEnv takes a List of NAME Objs (params
+	and then internal defines), the number of
+	params, an arglist, and an Env Obj, and turns
+	the arglist into a new Env Obj whose keys are
+	the names and whose enclosure is the Env. If
+	there are more or fewer arguments than params,
+	it reports the error and returns DUMMYOBJ
+	instead, and the procedure isn't entered.
+	extendClosureEnv does the same for a Closure
+	Obj, taking the names and the Env from it. The
+	interpreter makes each arglist big enough for
+	the procedure's defines as well (see localCount
+	in llh.c), so the frame is allocated just once;
+	compiled code doesn't know what it's calling
+	when it makes the arglist, so that frame is
+	copied into a bigger one if it's needed.
+
+	When a procedure calls itself in tail position
+	and nothing can see its frame anymore,
+	isSelfTailCall says so, and reuseFrame writes
+	the new arguments over the old ones instead of
+	making a new frame, so an iterative loop runs
+	in constant memory and not just constant stack.
+	An Env is 'captured' when a lambda is evaluated
+	in it (makeFunc and makeCompiled set the flag),
+	and its depth is the stack depth when its
+	procedure was entered.
+
+	That's all the escape analysis a frame needs:
+	one whose procedure never evaluates a lambda
+	can't outlive the call. Every frame the
+	evaluator makes is pushed on the frame stack
+	(pushFrame), and popFrames releases the ones
+	that are finished (the body has its value or
+	has made a tail call) as soon as the evaluator
+	stack unwinds past them. The free lists are
+	LIFO, so the next call's frame lands in the
+	same cells, and ordinary calls don't leave
+	anything for the collector.
 
 	Note that these functions all take Objs as
 	arguments: this is because they have to
@@ -68,26 +152,67 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 
 #include "objects.h"
 #include "flags.h"
 #include "primitives.h"
 #include "mem.h"
+#include "llh.h"
 
 /* env builders */
 
 extern Env* base_env;
 
+extern Env** frame_stack;
+extern int frame_top;
+
 Env* makeBaseEnv(void);
-Obj extendEnv(Obj vars_obj, Obj vals_obj, Obj base_env_obj);
+Obj extendEnv(Obj vars_obj, int param_count, Obj arglist, Obj base_env_obj);
+Obj extendClosureEnv(Obj func, Obj arglist);
+void pushFrame(Obj env_obj);
+void popFrames(int depth);
+void clearFrames(void);
+bool isSelfTailCall(Obj func, Obj env_obj, Obj arglist);
+Obj reuseFrame(Obj env_obj, Obj arglist);
+
+/* argument vectors */
+
+Obj makeArgs(int size);
+void setArg(Obj arglist, int index, Obj val);
+void releaseArgs(Obj arglist);
 
 /* lookup */
 
 Obj lookup(Obj var_obj, Obj env_obj);
+Obj simpleValue(Obj expr, Obj env_obj);
+Obj lookupFreeRef(Obj ref, Obj env_obj);
+
+	Obj lookup_in_env(Symbol* var, Env* env);
+	Obj lookup_in_frame(Symbol* var, Frame* frame);
+
+/* lexical addressing (see compile.c) */
+
+Obj lexicalLookup(int depth, int offset, Obj env_obj);
+void lexicalSet(int depth, int offset, Obj val_obj, Obj env_obj);
+
+	Binding* lexical_binding(int depth, int offset, Env* env);
 
-	Obj lookup_in_env(char* var, Env* env);
-	Obj lookup_in_frame(char* var, Frame* frame);
+/* the global table */
+
+#define EMPTY_SLOT -1
+#define INITIAL_GLOBAL_CAPACITY 64
+
+	int* global_slot(Symbol* var, Frame* frame);
+	void index_globals(Frame* frame, int capacity);
+	Obj lookup_global(Symbol* var);
+	void define_global(Symbol* var, Obj val_obj);
+
+/* inline caches for global references */
+
+extern int global_version;
+
+Obj cachedGlobalLookup(Symbol* var, int* index, int* version);
+Obj lookupGlobalRef(Obj ref);
 
 /* modify env */
 
@@ -97,6 +222,12 @@ void setVar(Obj var_obj, Obj val_obj, Obj env_obj);
 /* constructors */
 
 Frame* makeFrame(List* vars, List* vals);
+Frame* allocFrame(int size);
+Frame* growFrame(Frame* frame);
+Frame* resizeFrame(Frame* frame, int size);
+	void add_local(Frame* frame, Symbol* var);
+
+#define MIN_FRAME_GROWTH 4
 Env* makeEnv(Frame* frame, Env* enclosure);
 
 #endif
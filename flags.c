@@ -5,9 +5,17 @@ int INFO = 0;
 int STATS = 0;
 int STEP = 0;
 int TAIL = 1;
+int COMPILE = 1;
+int FLAT = 0;
 
 int LIB = 1;
 
+int BATCH = 0;
+int error_count = 0;
+
+char* image_path = NULL;
+char* dump_path = NULL;
+
 /* flag manipulation */
 
 void toggle_val(int* flag) {
@@ -31,4 +39,53 @@ void switch_flag(char* flag_name) {
 		toggle_val(&TAIL);
 	else if (streq(flag_name, _STEP))
 		toggle_val(&STEP);
+	else if (streq(flag_name, _COMPILE))
+		toggle_val(&COMPILE);
+	else if (streq(flag_name, _FLAT))
+		toggle_val(&FLAT);
+}
+
+/* command-line options */
+
+// options come before any files; returns how many argv
+// entries they take up. without a mode option, it's batch
+// mode unless stdin is a terminal and there are no files
+int set_options(int argc, char** argv) {
+	int count = 0;
+	bool chosen = false;
+
+	for (int i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (streq(argv[i], BATCH_OPTION))
+			BATCH = 1;
+		else if (streq(argv[i], INTERACTIVE_OPTION))
+			BATCH = 0;
+		else if (streq(argv[i], IMAGE_OPTION) && i + 1 < argc) {
+			image_path = argv[++i];
+			count += 2;
+			continue;
+		}
+		else if (streq(argv[i], DUMP_IMAGE_OPTION) && i + 1 < argc) {
+			dump_path = argv[++i];
+			count += 2;
+			continue;
+		}
+		else {
+			// stderr, since stdout isn't set up yet
+			fprintf(stderr, "unknown option: %s\n", argv[i]);
+			error_count++;
+			count++;
+			continue;
+		}
+		chosen = true;
+		count++;
+	}
+
+	if (!chosen)
+		BATCH = argc - 1 > count || !isatty(STDIN_FILENO);
+
+	// this has to happen before anything is printed to stdout
+	if (BATCH)
+		setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	return count;
 }
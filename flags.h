@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 extern int DEBUG;
 extern int INFO;
@@ -10,6 +11,30 @@ extern int STATS;
 extern int TAIL;
 extern int LIB;
 extern int STEP;
+extern int COMPILE;
+extern int FLAT;
+
+/* batch mode: no banner or prompts, output through
+	one big buffer, and the exit status says whether
+	anything went wrong (every error message counts
+	toward error_count) */
+
+extern int BATCH;
+extern int error_count;
+
+#define BATCH_OPTION "--batch"
+#define INTERACTIVE_OPTION "--interactive"
+
+/* heap images (see image.h): --image starts from
+	one instead of the library, and --dump-image
+	writes one on the way out */
+
+extern char* image_path;
+extern char* dump_path;
+
+#define IMAGE_OPTION "--image"
+#define DUMP_IMAGE_OPTION "--dump-image"
+#define OUTPUT_BUFFER_SIZE (1 << 20)
 
 // it would be nice if these didn't need newlines
 #define nlchar "\n"
@@ -19,6 +44,8 @@ extern int STEP;
 #define _STATS ".stats"nlchar
 #define _TAIL ".tail"nlchar
 #define _STEP ".step"nlchar
+#define _COMPILE ".compile"nlchar
+#define _FLAT ".flat"nlchar
 
 #define _HELP ".help"nlchar
 #define _QUIT ".quit"nlchar
@@ -28,6 +55,9 @@ extern int STEP;
 void toggle_val(int* flag);
 void switch_flag(char* flag_name);
 
+/* command-line options */
+int set_options(int argc, char** argv);
+
 /* from read.c */
 int streq(char* str1, char* str2);
 
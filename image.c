@@ -0,0 +1,634 @@
+#include "image.h"
+
+/* relocation goes one way or the other: pointers to
+	offsets when dumping, and back when loading */
+
+bool dumping;
+bool image_bad;
+
+// the heap
+char* image_base;
+size_t image_size;
+
+// indexed by the ids in the image
+Symbol** image_symbols;
+int image_symbol_count;
+
+// the code blocks, and where each one starts in all of
+// the code (with the total length at the end)
+Instr** image_blocks;
+int* image_block_starts;
+int image_block_count;
+
+// (when loading) indexed by word offset in the heap: the kind (plus one)
+// of the object whose body starts there, or 0
+unsigned char* image_kinds;
+
+// (when loading) the smallest body each kind can have
+size_t min_sizes[kind_count] = {
+	[LIST_KIND] = sizeof(List),
+	[PAIR_KIND] = sizeof(Pair),
+	[FRAME_KIND] = sizeof(Frame),
+	[ENV_KIND] = sizeof(Env),
+	[COMPILED_KIND] = sizeof(Compiled),
+	[CLOSURE_KIND] = sizeof(Closure),
+	[FREE_CELL] = 0,
+	[BROKEN_HEART] = 0
+};
+
+/* dump */
+
+bool dumpImage(char* path) {
+			if (DEBUG) printf("dumping image to \"%s\"...\n", path);
+
+	// afterwards the heap is a single chunk
+	collect_garbage();
+
+	dumping = true;
+	image_bad = false;
+
+	/* heap */
+
+	size_t heap_size = heap->free - heap->start;
+	char* objects = malloc(heap_size);
+	memcpy(objects, heap->start, heap_size);
+
+	image_base = heap->start;
+	image_size = heap_size;
+
+	/* code */
+
+	image_block_count = code_block_count;
+	image_blocks = malloc(image_block_count * sizeof(Instr*));
+	image_block_starts = malloc((image_block_count + 1) * sizeof(int));
+	int* lengths = malloc(image_block_count * sizeof(int));
+
+	int code_length = 0;
+	for (int i = 0; i < image_block_count; i++) {
+		image_blocks[i] = code_blocks[i].code;
+		image_block_starts[i] = code_length;
+		lengths[i] = code_blocks[i].length;
+		code_length += lengths[i];
+	}
+	image_block_starts[image_block_count] = code_length;
+
+	Instr* code = malloc(code_length * sizeof(Instr));
+	for (int i = 0; i < image_block_count; i++)
+		memcpy(code + image_block_starts[i], image_blocks[i],
+				lengths[i] * sizeof(Instr));
+
+	/* relocation (of the copies) */
+
+	for (char* scan = objects; scan < objects + heap_size;) {
+		Header* header = (Header*) scan;
+		relocate_object(header);
+		scan += sizeof(Header) + header->size;
+	}
+
+	for (int i = 0; i < image_block_count; i++)
+		relocate_block(code + image_block_starts[i], i);
+
+	void* env_ptr = base_env;
+	relocate_ptr(&env_ptr, ENV_KIND);
+
+	/* writing */
+
+	Symbol** symbols = all_symbols();
+	size_t names_size = 0;
+	for (int i = 0; i < symbol_count; i++)
+		names_size += strlen(symbols[i]->name) + 1;
+
+	ImageHeader header = {
+		.magic = IMAGE_MAGIC,
+		.version = IMAGE_VERSION,
+		.word_size = sizeof(void*),
+		.symbol_count = symbol_count,
+		.global_version = global_version,
+		.code_block_count = image_block_count,
+		.code_length = code_length,
+		.names_size = names_size,
+		.heap_size = heap_size,
+		.base_env = (size_t) env_ptr
+	};
+
+	FILE* file = image_bad ? NULL : fopen(path, "wb");
+	bool written = file != NULL;
+
+	if (written) {
+		fwrite(&header, sizeof(ImageHeader), 1, file);
+		for (int i = 0; i < symbol_count; i++)
+			fwrite(symbols[i]->name, strlen(symbols[i]->name) + 1, 1, file);
+		fwrite(objects, heap_size, 1, file);
+		fwrite(lengths, sizeof(int), image_block_count, file);
+		fwrite(code, sizeof(Instr), code_length, file);
+		written = !ferror(file);
+		if (fclose(file))
+			written = false;
+	}
+
+	free(symbols);
+	free(objects);
+	free(code);
+	free(lengths);
+	free(image_blocks);
+	free(image_block_starts);
+
+	if (image_bad)
+		return image_error("something unrelocatable in the way of", path);
+	if (!written)
+		return image_error("can't write", path);
+
+			if (DEBUG) printf("%zu bytes of heap, %d instructions, %d symbols\n",
+								heap_size, code_length, symbol_count);
+	return true;
+}
+
+/* load */
+
+/* nothing from the image touches the heap until all of it
+	has checked out: the chunk and the code blocks are only
+	linked in and registered at the end, and a bad image
+	is thrown away without leaving anything behind */
+
+bool loadImage(char* path) {
+			if (DEBUG) printf("loading image \"%s\"...\n", path);
+
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+
+	if (fd < 0 || fstat(fd, &info) < 0) {
+		if (fd >= 0)
+			close(fd);
+		return image_error("can't open", path);
+	}
+
+	size_t length = info.st_size;
+
+	if (length < sizeof(ImageHeader)) {
+		close(fd);
+		return image_error("not an image:", path);
+	}
+
+	char* map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return image_error("can't map", path);
+
+	ImageHeader header = *(ImageHeader*) map;
+
+	char* names = map + sizeof(ImageHeader);
+	size_t rest = length - sizeof(ImageHeader);
+
+	if (memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) ||
+			header.version != IMAGE_VERSION ||
+			header.word_size != sizeof(void*) ||
+			header.symbol_count < 0 ||
+			header.code_block_count < 0 ||
+			header.code_length < 0 ||
+			header.names_size > rest ||
+			header.heap_size > rest - header.names_size ||
+			header.heap_size % sizeof(void*) ||
+			(size_t) header.symbol_count > header.names_size ||
+			rest - header.names_size - header.heap_size !=
+				header.code_block_count * sizeof(int) +
+				header.code_length * sizeof(Instr) ||
+			(header.names_size && names[header.names_size - 1] != '\0')) {
+		munmap(map, length);
+		return image_error("not an image from this lispinc:", path);
+	}
+
+	// the rest of the sections, in order
+	char* objects = names + header.names_size;
+	char* lengths = objects + header.heap_size;
+	char* code = lengths + header.code_block_count * sizeof(int);
+
+	dumping = false;
+	image_bad = false;
+
+	/* symbols (interning more names than needed is harmless) */
+
+	image_symbol_count = header.symbol_count;
+	image_symbols = malloc(image_symbol_count * sizeof(Symbol*));
+
+	char* name = names;
+	for (int i = 0; i < image_symbol_count; i++) {
+		if (name == objects) {
+			image_symbol_count = i;
+			break;
+		}
+		image_symbols[i] = intern(name);
+		name += strlen(name) + 1;
+	}
+
+	/* heap */
+
+	size_t heap_size = header.heap_size;
+
+	Chunk* chunk = make_chunk(heap_size);
+	memcpy(chunk->start, objects, heap_size);
+	chunk->free = chunk->start + heap_size;
+
+	image_base = chunk->start;
+	image_size = heap_size;
+
+	/* code (each block on its own, as assemble makes them) */
+
+	image_block_count = header.code_block_count;
+	image_blocks = malloc(image_block_count * sizeof(Instr*));
+	image_block_starts = malloc((image_block_count + 1) * sizeof(int));
+
+	int code_length = 0;
+	for (int i = 0; i < image_block_count; i++) {
+		int block_length;
+		memcpy(&block_length, lengths + i * sizeof(int), sizeof(int));
+		if (block_length < 0 || block_length > header.code_length - code_length) {
+			image_bad = true;
+			block_length = 0;
+		}
+		image_blocks[i] = malloc(block_length * sizeof(Instr));
+		memcpy(image_blocks[i], code + code_length * sizeof(Instr),
+				block_length * sizeof(Instr));
+		image_block_starts[i] = code_length;
+		code_length += block_length;
+	}
+	image_block_starts[image_block_count] = code_length;
+
+	munmap(map, length);
+
+	/* relocation */
+
+	image_kinds = calloc(heap_size / sizeof(void*) + 1, 1);
+
+	if (!image_bad)
+		mark_objects();
+
+	for (char* scan = chunk->start; !image_bad && scan < chunk->free;) {
+		Header* object = (Header*) scan;
+		relocate_object(object);
+		scan += sizeof(Header) + object->size;
+	}
+
+	for (int i = 0; !image_bad && i < image_block_count; i++)
+		relocate_block(image_blocks[i], i);
+
+	void* env_ptr = (void*) header.base_env;
+	if (env_ptr == NULL)
+		image_bad = true;
+	relocate_ptr(&env_ptr, ENV_KIND);
+
+	free(image_kinds);
+	free(image_symbols);
+	image_kinds = NULL;
+	image_symbols = NULL;
+
+	if (image_bad) {
+		free(chunk);
+		for (int i = 0; i < image_block_count; i++)
+			free(image_blocks[i]);
+		free(image_blocks);
+		free(image_block_starts);
+		return image_error("corrupt image:", path);
+	}
+
+	/* it's good, so in it goes */
+
+	// as though the collector had just found all of this live
+	while (heap_capacity + heap_size > heap_limit / 2)
+		heap_limit *= 2;
+
+	link_chunk(chunk);
+
+	for (char* scan = chunk->start; scan < chunk->free;) {
+		Header* object = (Header*) scan;
+		live_count[object->kind]++;
+		allocated_count[object->kind]++;
+		scan += sizeof(Header) + object->size;
+	}
+
+	for (int i = 0; i < image_block_count; i++)
+		register_code(image_blocks[i],
+			image_block_starts[i + 1] - image_block_starts[i]);
+
+	free(image_blocks);
+	free(image_block_starts);
+
+	/* globals */
+
+	base_env = env_ptr;
+	global_version = header.global_version;
+
+	int capacity = INITIAL_GLOBAL_CAPACITY;
+	while (capacity < 2 * base_env->frame->count)
+		capacity *= 2;
+	index_globals(base_env->frame, capacity);
+
+	// the library is in the image
+	skip_library();
+
+			if (DEBUG) printf("%zu bytes of heap, %d instructions, %d symbols\n",
+								heap_size, code_length, image_symbol_count);
+	return true;
+}
+
+/* checking */
+
+// walks the headers and records where each object is
+void mark_objects(void) {
+	char* start = image_base;
+	char* end = image_base + image_size;
+
+	for (char* scan = start; scan < end;) {
+		Header* header = (Header*) scan;
+		char* body = scan + sizeof(Header);
+
+		if (body > end ||
+				header->kind >= kind_count ||
+				header->kind == BROKEN_HEART ||
+				header->size < 0 ||
+				header->size % sizeof(void*) ||
+				(size_t) header->size < min_sizes[header->kind] ||
+				header->size > end - body) {
+			image_bad = true;
+			return;
+		}
+
+		image_kinds[(body - start) / sizeof(void*)] = header->kind + 1;
+		scan = body + header->size;
+	}
+}
+
+/* relocation */
+
+// the same walk as scan_object in mem.c
+void relocate_object(Header* header) {
+	void* obj = header + 1;
+
+	switch (header->kind) {
+		case LIST_KIND: {
+			List* list = obj;
+			relocate_obj(&list->car);
+			relocate_ptr((void**) &list->cdr, LIST_KIND);
+			return;
+		}
+		case PAIR_KIND: {
+			Pair* pair = obj;
+			relocate_obj(&pair->car);
+			relocate_obj(&pair->cdr);
+			return;
+		}
+		case FRAME_KIND: {
+			Frame* frame = obj;
+			if (frame->count < 0 || frame->count > frame->size ||
+					sizeof(Frame) + frame->size * sizeof(Binding) > (size_t) header->size) {
+				image_bad = true;
+				return;
+			}
+			for (int i = 0; i < frame->count; i++) {
+				relocate_symbol(&frame->bindings[i].key);
+				relocate_obj(&frame->bindings[i].val);
+			}
+			// the spare bindings are left over from whatever used to be there
+			if (dumping)
+				memset(&frame->bindings[frame->count], 0,
+					(frame->size - frame->count) * sizeof(Binding));
+			return;
+		}
+		case ENV_KIND: {
+			Env* env = obj;
+			relocate_ptr((void**) &env->frame, FRAME_KIND);
+			relocate_ptr((void**) &env->enclosure, ENV_KIND);
+			if (!dumping && env->frame == NULL)
+				image_bad = true;
+			return;
+		}
+		case COMPILED_KIND: {
+			Compiled* compiled = obj;
+			relocate_code(&compiled->entry);
+			relocate_ptr((void**) &compiled->env, ENV_KIND);
+			relocate_obj(&compiled->params);
+			relocate_obj(&compiled->body);
+			return;
+		}
+		case CLOSURE_KIND: {
+			Closure* closure = obj;
+			if (closure->param_count < 0 || closure->local_count < 0 ||
+					sizeof(Closure) + (closure->param_count + closure->local_count)
+						* sizeof(Symbol*) > (size_t) header->size) {
+				image_bad = true;
+				return;
+			}
+			relocate_ptr((void**) &closure->env, ENV_KIND);
+			relocate_obj(&closure->body);
+			for (int i = 0; i < closure->param_count + closure->local_count; i++)
+				relocate_symbol(&closure->params[i]);
+			return;
+		}
+		case BROKEN_HEART:
+			image_bad = true;
+			return;
+		default:
+			return;
+	}
+}
+
+// instrs is block number block, or a copy of it
+void relocate_block(Instr* instrs, int block) {
+	int length = image_block_starts[block + 1] - image_block_starts[block];
+
+	for (int i = 0; i < length; i++) {
+		if (!dumping && (instrs[i].op >= op_count ||
+				instrs[i].target >= reg_count ||
+				instrs[i].source >= reg_count)) {
+			image_bad = true;
+			return;
+		}
+		relocate_obj(&instrs[i].obj);
+		relocate_label(&instrs[i].label, image_blocks[block], length);
+	}
+}
+
+// the kind of object each pointer tag points to
+Kind tag_kinds[] = {
+	[LIST] = LIST_KIND,
+	[PAIR] = PAIR_KIND,
+	[ENV] = ENV_KIND,
+	[COMPILED] = COMPILED_KIND,
+	[CLOSURE] = CLOSURE_KIND
+};
+
+void relocate_obj(Obj* obj) {
+	Tag tag = GETTAG(*obj);
+
+	switch (tag) {
+		case LIST:
+		case PAIR:
+		case ENV:
+		case COMPILED:
+		case CLOSURE: {
+			void* ptr = GETPTR(*obj);
+			relocate_ptr(&ptr, tag_kinds[tag]);
+			if (!dumping && tag != LIST && ptr == NULL)
+				image_bad = true;
+			*obj = PTROBJ(tag, ptr);
+			return;
+		}
+		case NAME: {
+			Symbol* sym = GETNAME(*obj);
+			relocate_symbol(&sym);
+			*obj = NAMEOBJ(sym);
+			return;
+		}
+		// a Prim is its index in prim_table, shifted past the tag
+		case PRIM: {
+			if (dumping) {
+				for (int i = 0; i < prim_count; i++)
+					if (prim_table[i] == GETPRIM(*obj)) {
+						*obj = PTROBJ(PRIM, (uintptr_t) i << TAG_BITS);
+						return;
+					}
+				image_bad = true;
+				return;
+			}
+			uintptr_t index = (uintptr_t) GETPTR(*obj) >> TAG_BITS;
+			if (index >= (uintptr_t) prim_count) {
+				image_bad = true;
+				*obj = DUMMYOBJ;
+				return;
+			}
+			*obj = PRIMOBJ(prim_table[index]);
+			return;
+		}
+		case CODE: {
+			Instr* instr = GETCODE(*obj);
+			if (!dumping && instr == NULL)
+				image_bad = true;
+			relocate_code(&instr);
+			*obj = CODEOBJ(instr);
+			return;
+		}
+		// immediates that index tables in the evaluator
+		case LABEL:
+			if (!dumping && GETLABEL(*obj) >= label_count)
+				image_bad = true;
+			return;
+		case FORM:
+			if (!dumping && GETFORM(*obj) >= form_count)
+				image_bad = true;
+			return;
+		case NUM:
+		case DUMMY:
+		case UNINIT:
+			return;
+		default:
+			image_bad = true;
+			return;
+	}
+}
+
+// a heap pointer is its offset from the start of the heap. when
+// loading, it has to be the start of an object of the right kind
+void relocate_ptr(void** ptr, Kind kind) {
+	if (*ptr == NULL)
+		return;
+
+	if (dumping) {
+		*ptr = (void*) ((char*) *ptr - image_base);
+		return;
+	}
+
+	size_t offset = (size_t) *ptr;
+	if (offset >= image_size || offset % sizeof(void*) ||
+			image_kinds[offset / sizeof(void*)] != kind + 1) {
+		image_bad = true;
+		*ptr = NULL;
+		return;
+	}
+	*ptr = image_base + offset;
+}
+
+// a Symbol is one more than its id, shifted past the tag
+// (there's nowhere a Symbol can be NULL)
+void relocate_symbol(Symbol** sym) {
+	if (*sym == NULL) {
+		image_bad = true;
+		return;
+	}
+
+	if (dumping) {
+		*sym = (Symbol*) ((uintptr_t) ((*sym)->id + 1) << TAG_BITS);
+		return;
+	}
+
+	uintptr_t id = ((uintptr_t) *sym >> TAG_BITS) - 1;
+	if (id >= (uintptr_t) image_symbol_count) {
+		image_bad = true;
+		*sym = NULL;
+		return;
+	}
+	*sym = image_symbols[id];
+}
+
+// a pointer into code is one more than its place in all of the code
+void relocate_code(Instr** instr) {
+	if (*instr == NULL)
+		return;
+
+	int code_length = image_block_starts[image_block_count];
+
+	if (dumping) {
+		for (int i = 0; i < image_block_count; i++) {
+			int length = image_block_starts[i + 1] - image_block_starts[i];
+			if (*instr >= image_blocks[i] && *instr < image_blocks[i] + length) {
+				uintptr_t index = image_block_starts[i] + (*instr - image_blocks[i]);
+				*instr = (Instr*) (index + 1);
+				return;
+			}
+		}
+		image_bad = true;
+		return;
+	}
+
+	uintptr_t index = (uintptr_t) *instr - 1;
+	if (index >= (uintptr_t) code_length) {
+		image_bad = true;
+		*instr = NULL;
+		return;
+	}
+
+	// the last block that starts at or before index
+	int low = 0, high = image_block_count - 1;
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (image_block_starts[mid] <= (int) index)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	*instr = image_blocks[low] + (index - image_block_starts[low]);
+}
+
+// a label is one more than its place in its own block
+void relocate_label(Instr** label, Instr* block, int length) {
+	if (*label == NULL)
+		return;
+
+	if (dumping) {
+		*label = (Instr*) ((uintptr_t) (*label - block) + 1);
+		return;
+	}
+
+	uintptr_t index = (uintptr_t) *label - 1;
+	if (index >= (uintptr_t) length) {
+		image_bad = true;
+		*label = NULL;
+		return;
+	}
+	*label = block + index;
+}
+
+bool image_error(char* message, char* path) {
+	printf("%s \"%s\" -- image\n", message, path);
+	error_count++;
+	return false;
+}
@@ -0,0 +1,125 @@
+/*
+	IMAGE
+
+	Every run starts out by reading, analyzing and
+	evaluating the library (see lib.c), one
+	definition per trip through START, and with a
+	big library that takes longer than whatever the
+	run was for. An image is a snapshot of the heap
+	that skips all of that: lispinc --dump-image FILE
+	writes one when it quits, and lispinc --image
+	FILE starts from one, with everything the first
+	run had defined already defined.
+
+	Dumping starts with a collection. By the time
+	lispinc is quitting, nothing much is live but
+	base_env and the constants in compiled code, so
+	afterwards the heap is a single chunk holding
+	just what those can reach, packed together with
+	its Headers. That chunk is written
+	out more or less as is, except that the pointers
+	in it have to mean something in another process:
+	a heap pointer becomes its offset from the start
+	of the chunk, a Symbol becomes its id (plus one,
+	so that NULL stays NULL), and a Prim becomes its
+	place in prim_table. The names of the symbols
+	are written out ahead of the heap, in id order.
+
+	Loading maps the file, interns the names (so the
+	ids can be turned back into Symbols), copies the
+	heap part into a fresh chunk, and walks it one
+	object at a time (the same walk the collector
+	does) putting real pointers back. Then base_env
+	is pointed at the loaded one and the global
+	table is rebuilt. It's one pass over memory (two,
+	counting the checks below), so it's over in a few
+	milliseconds, and after that the loaded objects
+	are ordinary heap objects.
+
+	A file that claims to be an image is checked
+	before any of it is used: every Header has to
+	be aligned, of a real kind and big enough for
+	that kind, and every heap pointer has to land
+	on the start of an object of the kind its tag
+	(or field) says. Only once all of it checks out
+	is the chunk linked into the heap and the code
+	registered; otherwise all of it is thrown away.
+	That catches a truncated or scribbled-on file,
+	but it's a structural check, not a proof: an
+	image with the right shape and nonsense in it
+	can still make the evaluator do nonsense.
+
+	Compiled code isn't in the heap (see
+	register_code in mem.c), so the code blocks
+	come after the heap, one after another, and
+	get the same treatment. A pointer into code
+	(the entry of a compiled procedure, or a
+	compiled continuation) becomes its place in
+	all of the code, plus one; a label becomes its
+	place in its own block, plus one; and each
+	instruction's constant is relocated like any
+	other Obj. Loading gives each block its own
+	allocation again and registers it, just as
+	assemble does.
+
+	An image only makes sense to the lispinc that
+	wrote it (same object layouts, same primitives),
+	which is what the version and word size in the
+	header are a rough check of.
+*/
+
+#ifndef IMAGE_GUARD
+#define IMAGE_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "objects.h"
+#include "flags.h"
+#include "symbol.h"
+#include "env.h"
+#include "mem.h"
+#include "lib.h"
+#include "primitives.h"
+#include "vm.h"
+
+#define IMAGE_MAGIC "lispinc"
+#define IMAGE_VERSION 1
+
+typedef struct ImageHeader ImageHeader;
+
+// after the header: the names, the heap, the length of
+// each code block, and then the code blocks themselves
+struct ImageHeader {
+	char magic[8];
+	int version;
+	int word_size;
+	int symbol_count;
+	int global_version;
+	int code_block_count;
+	int code_length;
+	size_t names_size;
+	size_t heap_size;
+	size_t base_env;
+};
+
+bool dumpImage(char* path);
+bool loadImage(char* path);
+
+	void mark_objects(void);
+	void relocate_object(Header* header);
+	void relocate_block(Instr* block, int length);
+	void relocate_obj(Obj* obj);
+	void relocate_ptr(void** ptr, Kind kind);
+	void relocate_symbol(Symbol** sym);
+	void relocate_code(Instr** instr);
+	void relocate_label(Instr** label, Instr* block, int length);
+	bool image_error(char* message, char* path);
+
+#endif
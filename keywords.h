@@ -5,7 +5,8 @@
 
 #define OPENPAREN(X)  X == '(' || X == '['  || X == '{'
 #define CLOSEPAREN(X) X == ')' || X == ']'  || X == '}'
-#define WHITESPACE(X) X == ' ' || X == '\n' || X == '\t'
+#define WHITESPACE(X) X == ' ' || X == '\n' || X == '\t' || X == '\r'
+#define COMMENT(X)    X == ';'
 
 /* reserved words */
 
@@ -15,6 +16,7 @@
 #define QUOTE_KEY "quote"
 #define ASS_KEY "set!"
 #define BEGIN_KEY "begin"
+#define LOAD_KEY "load"
 
 /* non-flag user commands */
 
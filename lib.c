@@ -1,8 +1,13 @@
 #include "lib.h"
 
-/* list operations */
+/* list operations (cons, car and cdr are primitives
+	unless lispinc is built with -DLAMBDA_PAIRS) */
 
+#ifdef LAMBDA_PAIRS
 #define list_count 4
+#else
+#define list_count 1
+#endif
 
 #define cons \
 	"("DEF_KEY" cons \
@@ -89,9 +94,12 @@
 /* newlines are needed because of some quirk in the
 	parsing process (see read.c and parse.c) */
 
-char* library[] = {cons"\n",
+char* library[] = {
+#ifdef LAMBDA_PAIRS
+					 cons"\n",
 					 car"\n", 
 					 cdr"\n", 
+#endif
 					 nil"\n", 
 					 zero_"\n",
 					 add1"\n", 
@@ -127,3 +135,8 @@ void print_lib(void) {
 bool lib_loaded(void) {
 	return lib_counter >= lib_len;
 }
+
+// when the library came in an image (see image.c)
+void skip_library(void) {
+	lib_counter = lib_len;
+}
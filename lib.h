@@ -10,7 +10,11 @@
 	has the advantages that 1) it's more theoretically 
 	elegant to avoid unneeded primitives and 2) it saves 
 	the trouble of having to deal primitive C functions 
-	any more than is necessary.
+	any more than is necessary. It has the disadvantage
+	of being slow (every car is two procedure calls),
+	so cons, car and cdr are now primitives (see
+	primitives.c), and the lambda definitions are only
+	loaded when lispinc is built with -DLAMBDA_PAIRS.
 
 	read.c loops over the length of the library to load 
 	library functions, then switches to reading user 
@@ -40,6 +44,7 @@
 
 char* load_library(void);
 bool lib_loaded(void);
+void skip_library(void);
 
 void print_lib(void);
 
@@ -9,7 +9,7 @@
 
 bool isQuit(Obj expr) {
 	return GETTAG(expr) == NAME &&
-		cmpForm(GETNAME(expr), QUIT_COMMAND);
+		GETNAME(expr) == intern(QUIT_COMMAND);
 }
 
 /* primitive types */
@@ -22,35 +22,128 @@ bool isVar(Obj expr) {
 	return GETTAG(expr) == NAME;
 }
 
-/* special forms */
+/* global references (made by analyze.c) look
+	like (GLOBAL name index version), where index
+	and version are an inline cache (see env.c) */
 
-char* specialForm(Obj expr) {
-	// return GETLIST(expr)->car.val.name;
-	return GETNAME(CAR(GETLIST(expr)));
+bool isGlobalRef(Obj expr) {
+	return GETTAG(expr) == LIST &&
+		GETLIST(expr) != NULL &&
+		hasForm(expr, GLOBAL_FORM);
 }
 
-bool cmpForm(char* cand, char* form) {
-	return strcmp(cand, form) == 0;
+// evaluating these can't touch any registers (see env.c)
+bool isSimple(Obj expr) {
+	if (isNum(expr) || isVar(expr))
+		return true;
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return false;
+
+	Form form = formOf(expr);
+	return form == GLOBAL_FORM || form == FREE_FORM || form == QUOTE_FORM;
+}
+
+Obj makeGlobalRef(Obj var) {
+	List* cache = makeList(NUMOBJ(0), makeList(NUMOBJ(0), NULL));
+	List* ref = makeList(FORMOBJ(GLOBAL_FORM), makeList(var, cache));
+	return LISTOBJ(ref);
+}
+
+Obj globalName(Obj expr) {
+	return CADR(GETLIST(expr));
+}
+
+/* free variables of flat closures: (FREE index name) */
+
+bool isFreeRef(Obj expr) {
+	return GETTAG(expr) == LIST &&
+		GETLIST(expr) != NULL &&
+		hasForm(expr, FREE_FORM);
+}
+
+Obj makeFreeRef(Obj var, int index) {
+	List* ref = makeList(FORMOBJ(FREE_FORM),
+					makeList(NUMOBJ(index), makeList(var, NULL)));
+	return LISTOBJ(ref);
+}
+
+int freeIndex(Obj expr) {
+	return GETNUM(CADR(GETLIST(expr)));
+}
+
+Obj freeName(Obj expr) {
+	return CADDR(GETLIST(expr));
+}
+
+/* internal definitions */
+
+// conses onto names every name defined in expr
+List* scan_defines(Obj expr, List* names) {
+	if (GETTAG(expr) != LIST || GETLIST(expr) == NULL)
+		return names;
+
+	List* list = GETLIST(expr);
+
+	switch (formOf(expr)) {
+		case QUOTE_FORM:
+		case LOAD_FORM:
+		case LAMBDA_FORM:
+		case FLAT_LAMBDA_FORM:
+		case GLOBAL_FORM:
+		case FREE_FORM:
+			return names;
+		case DEF_FORM:
+			if (!hasName(GETNAME(defVar(expr)), names))
+				names = makeList(defVar(expr), names);
+			return scan_defines(defVal(expr), names);
+		case ASS_FORM:
+			return scan_defines(assVal(expr), names);
+		default:
+			for (; list; list = CDR(list))
+				names = scan_defines(CAR(list), names);
+			return names;
+	}
 }
 
-bool hasForm(Obj expr, char* form) {
-	return cmpForm(specialForm(expr), form);
+bool hasName(Symbol* var, List* names) {
+	for (; names; names = CDR(names))
+		if (GETNAME(CAR(names)) == var)
+			return true;
+	return false;
+}
+
+/* special forms (marked by analyze.c) */
+
+Form formOf(Obj expr) {
+	Obj head = CAR(GETLIST(expr));
+	return GETTAG(head) == FORM ?
+		GETFORM(head) : APP_FORM;
+}
+
+bool hasForm(Obj expr, Form form) {
+	return formOf(expr) == form;
 }
 
 /* quotation */
 
 bool isQuote(Obj expr) {
-	return hasForm(expr, QUOTE_KEY);
+	return hasForm(expr, QUOTE_FORM);
 }
 
 Obj quotedText(Obj expr) {
 	return CADR(GETLIST(expr));
 }
 
+/* load (see read.c) */
+
+Obj loadPath(Obj expr) {
+	return CADR(GETLIST(expr));
+}
+
 /* begin */
 
 bool isBegin(Obj expr) {
-	return hasForm(expr, BEGIN_KEY);
+	return hasForm(expr, BEGIN_FORM);
 }
 
 Obj beginActions(Obj expr) {
@@ -60,7 +153,7 @@ Obj beginActions(Obj expr) {
 /* if (and other boolean macros) */
 
 bool isIf(Obj expr) {
-	return hasForm(expr, IF_KEY);
+	return hasForm(expr, IF_FORM);
 }
 
 Obj ifTest(Obj expr) {
@@ -83,37 +176,102 @@ Obj ifElse(Obj expr) {
 /* lambda */
 
 bool isLambda(Obj expr) {
-	return hasForm(expr, FUN_KEY);
+	return hasForm(expr, LAMBDA_FORM);
+}
+
+bool isAnyLambda(Obj expr) {
+	return isLambda(expr) || hasForm(expr, FLAT_LAMBDA_FORM);
 }
 
 Obj lambdaParams(Obj expr) {
 	return CADR(GETLIST(expr));
 }
 
-/* to allow for implicit begin blocks, change this
-and some other functions to provide for a list of
-body expressions; otherwise, explicit begins are needed
-for, e.g, iterative factorial */
+// the names defined in the body (scanned out by analyze.c)
+Obj lambdaLocals(Obj expr) {
+	return CADDR(GETLIST(expr));
+}
 
+// the list of body expressions (an implicit begin)
 Obj lambdaBody(Obj expr) {
-	return CADDR(GETLIST(expr));
+	return LISTOBJ(CDDDR(GETLIST(expr)));
+}
+
+// params are copied into the closure, so applying it
+// doesn't have to walk the lambda expression
+Obj makeFunc(Obj lambda, Obj env) {
+	GETENV(env)->captured = true;
+	return makeClosure(lambdaParams(lambda), lambdaLocals(lambda),
+				lambdaBody(lambda), GETENV(env));
 }
 
-Obj makeFunc(Obj params, Obj body, Obj env) {
-	List* list = 
-		makeList(NAMEOBJ(FUN_KEY),
-			makeList(params,
-				makeList(body,
-					makeList(env, NULL))));
+/* a flat lambda (see analyze.c) is (lambda params locals
+	captures body), where captures has an expression for each free
+	variable, to be evaluated where the lambda is. their
+	values are copied into an env of the closure's own, and
+	the env where the lambda is evaluated isn't captured */
 
-	Obj obj = LISTOBJ(list);
-	return obj;
+Obj flatCaptures(Obj expr) {
+	return CADDDR(GETLIST(expr));
+}
+
+Obj makeFlatFunc(Obj lambda, Obj env) {
+	List* captures = GETLIST(flatCaptures(lambda));
+	int count = listLength(captures);
+
+	Env* flat_env = base_env;
+
+	if (count) {
+		Frame* frame = allocFrame(count);
+		for (int i = 0; i < count; i++) {
+			Obj capture = captures->car;
+			frame->bindings[i].key = GETNAME(isFreeRef(capture) ?
+											freeName(capture) : capture);
+			frame->bindings[i].val = simpleValue(capture, env);
+			captures = captures->cdr;
+		}
+		frame->count = count;
+		flat_env = makeEnv(frame, base_env);
+	}
+
+	return makeClosure(lambdaParams(lambda), lambdaLocals(lambda),
+				LISTOBJ(CDR(CDDDR(GETLIST(lambda)))), flat_env);
+}
+
+Obj makeClosure(Obj params_obj, Obj locals_obj, Obj body, Env* env) {
+	List* params = GETLIST(params_obj);
+	List* locals = GETLIST(locals_obj);
+	int param_count = listLength(params);
+	int local_count = listLength(locals);
+
+	Closure* closure = allocate(CLOSURE_KIND, sizeof(Closure) +
+						(param_count + local_count) * sizeof(Symbol*));
+	closure->env = env;
+	closure->body = body;
+	closure->param_count = param_count;
+	closure->local_count = local_count;
+
+	Symbol** names = closure->params;
+
+	for (; params; params = params->cdr)
+		*names++ = GETNAME(params->car);
+	for (; locals; locals = locals->cdr)
+		*names++ = GETNAME(locals->car);
+
+	return CLOSUREOBJ(closure);
+}
+
+int listLength(List* list) {
+	int length = 0;
+	for (; list; list = list->cdr)
+		length++;
+	return length;
 }
 
 /* ass, def */
 
 bool isAss(Obj expr) {
-	return hasForm(expr, ASS_KEY);
+	return hasForm(expr, ASS_FORM);
 }
 
 Obj assVar(Obj expr) {
@@ -127,7 +285,7 @@ Obj assVal(Obj expr) {
 // -- setVar in env.c
 
 bool isDef(Obj expr) {
-	return hasForm(expr, DEF_KEY);
+	return hasForm(expr, DEF_FORM);
 }
 
 Obj defVar(Obj expr) {
@@ -164,44 +322,28 @@ bool isLastArg(Obj expr) {
 	return CDR(GETLIST(expr)) == NULL;
 }
 
-/* adjoinArg (with its own helpers) */
-
-void appendObj(Obj obj, List** list) {
-	if (*list == NULL) {
-		*list = malloc(sizeof(List));
-		(*list)->car = obj;
-		(*list)->cdr = NULL;
-		return;
-	}
-	else appendObj(obj, &((*list)->cdr));
-}
-
-List* reverse(List* list) {
-	if (list == NULL)
-		return NULL;
-
-	Obj car = list->car;
-	List* cdr = list->cdr;
-	List* head = reverse(cdr);
-	appendObj(car, &head);
-	return head;
+int countArgs(Obj expr) {
+	return listLength(GETLIST(expr));
 }
 
 /*
-	adjoinArg conses val to the front of
-	arglist, then reverses the whole thing.
-	this isn't efficient, but it was
-	shockingly and insurmountably difficult
-	to do it more straighforwardly.
+	adjoinArg puts val in the next free slot of
+	the argument vector (see makeArgs in env.c).
+	the vector was sized from the operand count,
+	so there's always room, and nothing has to be
+	copied or reversed.
 */
 
 Obj adjoinArg(Obj val, Obj arglist) {
-	List* args = GETLIST(arglist);
-	List* head = malloc(sizeof(List));
-	head->car = val;
-	head->cdr = args;
-	head = reverse(head);
-	return LISTOBJ(head);
+	Frame* args = GETENV(arglist)->frame;
+	if (args->count == args->size) {
+		printf("too many arguments -- adjoinArg\n");
+		error_count++;
+		return arglist;
+	}
+	ARG(args, args->count) = val;
+	args->count++;
+	return arglist;
 }
 
 Obj restArgs(Obj expr) {
@@ -234,53 +376,91 @@ bool isPrimitive(Obj obj) {
 }
 
 bool isCompound(Obj obj) {
-	return GETTAG(obj) == LIST;
+	return GETTAG(obj) == CLOSURE;
+}
+
+bool isCompiled(Obj obj) {
+	return GETTAG(obj) == COMPILED;
 }
 
 Obj applyPrimitive(Obj func, Obj arglist) {
 			if (INFO) printf("%s\n", "applying PRIMITIVE...");
-	List* list = GETLIST(arglist);
+	Frame* args = GETENV(arglist)->frame;
 
-	primType type = func.val.prim.type;
+	Prim* prim_func = GETPRIM(func);
+	primType type = prim_func->type;
+
+	// the primitives only look at the slots they expect
+	if (args->count != prim_func->arity) {
+		printf("wrong number of arguments -- applyPrimitive\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
 
 	if (type == INTPRIM) {
-		int arg1 = list->car.val.num;
-		int arg2 = list->cdr->car.val.num;
+		int arg1 = GETNUM(ARG(args, 0));
+		int arg2 = GETNUM(ARG(args, 1));
 				if (INFO) printf("arg1: %d\narg2: %d\n\n", arg1, arg2);
-		intFunc prim = func.val.prim.func.intfunc;
+		intFunc prim = prim_func->func.intfunc;
 		int result = (*prim)(arg1, arg2);
 		return NUMOBJ(result);
 	}
 	
 	else if (type == OBJPRIM) {
-		Obj arg = list->car;
+		Obj arg = ARG(args, 0);
 				if (INFO) ;
-		objFunc prim = func.val.prim.func.objfunc;
+		objFunc prim = prim_func->func.objfunc;
 		int result = (*prim)(arg);
 		return NUMOBJ(result);
 	}
 
+	else if (type == ARGSPRIM) {
+		argsFunc prim = prim_func->func.argsfunc;
+		return (*prim)(args);
+	}
+
 	else {
 		printf("apply_primitive: unknown primitive function type!\n");
+		error_count++;
 		return DUMMYOBJ;
 	}
 }
 
-// make sure these coordinate with makeFunc
+Obj funcBody(Obj obj) {
+	return GETCLOSURE(obj)->body;
+}
 
-Obj funcParams(Obj obj) {
-	return CADR(GETLIST(obj));
+Obj funcEnv(Obj obj) {
+	return ENVOBJ(GETCLOSURE(obj)->env);
 }
 
-Obj funcBody(Obj obj) {
-	return LISTOBJ(CDDR(GETLIST(obj)));
+// the slots a procedure's frame needs besides its args
+int localCount(Obj func) {
+	if (isCompound(func))
+		return GETCLOSURE(func)->local_count;
+	if (isCompiled(func))
+		return GETCOMPILED(func)->local_count;
+	return 0;
 }
 
-Obj funcEnv(Obj obj) {
-	return CADDDR(GETLIST(obj));
+Obj makeCompiled(Instr* entry, Obj lambda, Obj env) {
+	Compiled* compiled = allocate(COMPILED_KIND, sizeof(Compiled));
+	compiled->entry = entry;
+	compiled->env = GETENV(env);
+	compiled->env->captured = true;
+	compiled->params = lambdaParams(lambda);
+	compiled->body = lambdaBody(lambda);
+	compiled->local_count = listLength(GETLIST(lambdaLocals(lambda)));
+	return COMPILEDOBJ(compiled);
+}
+
+Instr* compiledEntry(Obj obj) {
+	return GETCOMPILED(obj)->entry;
 }
 
-// extendEnv in env.c
+Obj compiledEnv(Obj obj) {
+	return ENVOBJ(GETCOMPILED(obj)->env);
+}
 
 /* sequence */
 
@@ -293,18 +473,12 @@ Obj restExps(Obj seq) {
 	return LISTOBJ(CDR(GETLIST(seq)));
 }
 
-// UGLY HACK
 bool isLastExp(Obj seq) {
-	List* next = CDR(GETLIST(seq));
-	return next == NULL || next->car.tag == ENV;
-	//return CDR(GETLIST(seq)) == NULL;
+	return CDR(GETLIST(seq)) == NULL;
 }
 
-// UGLY HACK
 bool noExps(Obj seq) {
-	List* list = GETLIST(seq);
-	return GETLIST(seq) == NULL ||
-				list->car.tag == ENV;
+	return GETLIST(seq) == NULL;
 }
 
 
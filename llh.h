@@ -11,7 +11,8 @@
 	bizarrely difficult to implement correctly 
 	and stalled the whole project for three days.
 	Several failed attempts have been preserved
-	at the end of the file.
+	at the end of the file. (These days arglists
+	are vectors, and adjoinArg is two lines.)
 */
 
 #ifndef LLH_GUARD
@@ -20,20 +21,31 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
-#include <string.h>
 		
 #include "objects.h"
 #include "keywords.h"
 #include "flags.h"
+#include "symbol.h"
+#include "mem.h"
 
 bool isQuit(Obj expr);
 bool isNum(Obj expr);
 bool isVar(Obj expr);
-char* specialForm(Obj expr);
-bool cmpForm(char* cand, char* form);
-bool hasForm(Obj expr, char* form);
+bool isGlobalRef(Obj expr);
+bool isSimple(Obj expr);
+Obj makeGlobalRef(Obj var);
+Obj globalName(Obj expr);
+bool isFreeRef(Obj expr);
+Obj makeFreeRef(Obj var, int index);
+int freeIndex(Obj expr);
+Obj freeName(Obj expr);
+List* scan_defines(Obj expr, List* names);
+bool hasName(Symbol* var, List* names);
+Form formOf(Obj expr);
+bool hasForm(Obj expr, Form form);
 bool isQuote(Obj expr);
 Obj quotedText(Obj expr);
+Obj loadPath(Obj expr);
 bool isBegin(Obj expr);
 Obj beginActions(Obj expr);
 bool isIf(Obj expr);
@@ -42,9 +54,15 @@ bool isTrue(Obj expr);
 Obj ifThen(Obj expr);
 Obj ifElse(Obj expr);
 bool isLambda(Obj expr);
+bool isAnyLambda(Obj expr);
 Obj lambdaParams(Obj expr);
+Obj lambdaLocals(Obj expr);
 Obj lambdaBody(Obj expr);
-Obj makeFunc(Obj params, Obj body, Obj env);
+Obj makeFunc(Obj lambda, Obj env);
+Obj flatCaptures(Obj expr);
+Obj makeFlatFunc(Obj lambda, Obj env);
+Obj makeClosure(Obj params_obj, Obj locals_obj, Obj body, Env* env);
+int listLength(List* list);
 bool isAss(Obj expr);
 Obj assVar(Obj expr);
 Obj assVal(Obj expr);
@@ -56,14 +74,19 @@ Obj getFunc(Obj expr);
 bool noArgs(Obj expr);
 Obj firstArg(Obj expr);
 bool isLastArg(Obj expr);
+int countArgs(Obj expr);
 Obj adjoinArg(Obj val, Obj arglist);
 Obj restArgs(Obj expr);
 bool isPrimitive(Obj obj);
 bool isCompound(Obj obj);
+bool isCompiled(Obj obj);
 Obj applyPrimitive(Obj func, Obj arglist);
-Obj funcParams(Obj obj);
 Obj funcBody(Obj obj);
 Obj funcEnv(Obj obj);
+int localCount(Obj func);
+Obj makeCompiled(Instr* entry, Obj lambda, Obj env);
+Instr* compiledEntry(Obj obj);
+Obj compiledEnv(Obj obj);
 Obj firstExp(Obj seq);
 Obj restExps(Obj seq);
 bool isLastExp(Obj seq);
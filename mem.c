@@ -1,101 +1,302 @@
 #include "mem.h"
 
-void free_memory(void) {
-			if (DEBUG) printf("freeing memory...\n");
+/* the heap */
+
+Chunk* heap;
+size_t heap_capacity;
+
+bool gc_pending = false;
+int gc_count = 0;
+size_t heap_limit = INITIAL_HEAP_LIMIT;
+size_t heap_live = 0;
+
+#define ALIGN(N) (((N) + 7) & ~(size_t)7)
 
-	free_lists();
-	free_envs();
+char* kind_names[kind_count] = {
+	"List cells",
+	"Pairs",
+	"Frames",
+	"Envs",
+	"Compiled procedures",
+	"Closures",
+	"Free cells",
+	"Broken hearts"
+};
+
+int live_count[kind_count];
+int allocated_count[kind_count];
+
+/* free lists, indexed by size in words; a free cell
+	holds the next free cell in its first word */
+
+Header* free_cells[MAX_POOLED_SIZE / 8 + 1];
+
+Chunk* make_chunk(size_t size) {
+	Chunk* chunk = malloc(sizeof(Chunk) + size);
+	chunk->next = NULL;
+	chunk->free = chunk->start;
+	chunk->end = chunk->start + size;
+	return chunk;
 }
 
-/* lists */
+void* allocate(Kind kind, size_t size) {
+	size = ALIGN(size);
+	live_count[kind]++;
+	allocated_count[kind]++;
 
-/* list of lists allocated */
-List_list* lists_head;
-List_list* lists_tail;
+	if (size <= MAX_POOLED_SIZE && free_cells[size / 8]) {
+		Header* header = free_cells[size / 8];
+		free_cells[size / 8] = *(Header**) (header + 1);
+		header->kind = kind;
+		return header + 1;
+	}
 
-void free_lists(void) {
-			if (DEBUG) printf("freeing lists...\n");
+	size_t total = sizeof(Header) + size;
 
-	if (lists_head == NULL)
-		return;
+	if (heap == NULL || heap->free + total > heap->end)
+		add_chunk(total > HEAP_CHUNK_SIZE ? total : HEAP_CHUNK_SIZE);
 
-	List_list* temp = lists_head;
-	lists_head = lists_head->next;
-	free_list(&(temp->list));
-	free_lists();
+	Header* header = (Header*) heap->free;
+	heap->free += total;
+	header->kind = kind;
+	header->size = size;
+	return header + 1;
 }
 
-void free_list(List** list) {
-	if (*list == NULL)
-		return;
+// the new chunk is the one allocated from
+Chunk* add_chunk(size_t size) {
+	Chunk* chunk = make_chunk(size);
+	link_chunk(chunk);
+	return chunk;
+}
 
-	List* temp = *list;
-	*list = (*list)->cdr;
-	free(temp);
-	temp = NULL;
-	free_list(list);
+void link_chunk(Chunk* chunk) {
+	chunk->next = heap;
+	heap = chunk;
+	heap_capacity += chunk->end - chunk->start;
+	if (heap_capacity > heap_limit)
+		gc_pending = true;
 }
 
-void append_to_lists(List* list) {
-	if (lists_tail)
-		lists_tail = lists_tail->next;
+// the caller promises that nothing else points to obj
+void release(void* obj) {
+	Header* header = (Header*) obj - 1;
+	live_count[header->kind]--;
+	header->kind = FREE_CELL;
 
-	lists_tail = malloc(sizeof(List_list));
-	lists_tail->list = list;
-	lists_tail->next = NULL;
+	if (header->size <= MAX_POOLED_SIZE) {
+		*(Header**) obj = free_cells[header->size / 8];
+		free_cells[header->size / 8] = header;
+	}
+}
 
-	if (!lists_head)
-		lists_head = lists_tail;
+size_t heap_used(void) {
+	size_t used = 0;
+	for (Chunk* chunk = heap; chunk; chunk = chunk->next)
+		used += chunk->free - chunk->start;
+	return used;
 }
 
-/* envs */
+/* stop-and-copy */
+
+// objects are copied to the end of to_space
+Chunk* to_space;
 
-/* list of envs established */
-Env_list* envs_head;
-Env_list* envs_tail;
+void* forward(void* obj) {
+	if (obj == NULL)
+		return NULL;
 
-void free_envs(void) {
-			if (DEBUG) printf("freeing envs...\n");
+	Header* header = (Header*) obj - 1;
+	if (header->kind == BROKEN_HEART)
+		return *(void**) obj;
 
-	if (envs_head == NULL)
-		return;
+	size_t total = sizeof(Header) + header->size;
+	Header* copy = (Header*) to_space->free;
+	memcpy(copy, header, total);
+	to_space->free += total;
 
-	Env_list* temp = envs_head;
-	envs_head = envs_head->next;
-	free_env(&(temp->env));
-	free_envs();
+	header->kind = BROKEN_HEART;
+	*(void**) obj = copy + 1;
+	return copy + 1;
 }
 
-void free_env(Env** env) {
-	if (*env == NULL)
-		return;
+void forward_obj(Obj* obj) {
+	switch (GETTAG(*obj)) {
+		case LIST:
+			*obj = LISTOBJ(forward(GETLIST(*obj)));
+			return;
+		case PAIR:
+			*obj = PAIROBJ(forward(GETPAIR(*obj)));
+			return;
+		case ENV:
+			*obj = ENVOBJ(forward(GETENV(*obj)));
+			return;
+		case COMPILED:
+			*obj = COMPILEDOBJ(forward(GETCOMPILED(*obj)));
+			return;
+		case CLOSURE:
+			*obj = CLOSUREOBJ(forward(GETCLOSURE(*obj)));
+			return;
+		default:
+			return;
+	}
+}
 
-	Frame* temp = (*env)->frame;
-	free(*env);
-	*env = NULL;
-	free_frame(&temp);
+// forwards the objects that an already-copied object points to
+void scan_object(Header* header) {
+	void* obj = header + 1;
+
+	switch (header->kind) {
+		case LIST_KIND: {
+			List* list = obj;
+			forward_obj(&list->car);
+			list->cdr = forward(list->cdr);
+			return;
+		}
+		case PAIR_KIND: {
+			Pair* pair = obj;
+			forward_obj(&pair->car);
+			forward_obj(&pair->cdr);
+			return;
+		}
+		case FRAME_KIND: {
+			Frame* frame = obj;
+			for (int i = 0; i < frame->count; i++)
+				forward_obj(&frame->bindings[i].val);
+			return;
+		}
+		case ENV_KIND: {
+			Env* env = obj;
+			env->frame = forward(env->frame);
+			env->enclosure = forward(env->enclosure);
+			return;
+		}
+		case COMPILED_KIND: {
+			Compiled* compiled = obj;
+			compiled->env = forward(compiled->env);
+			forward_obj(&compiled->params);
+			forward_obj(&compiled->body);
+			return;
+		}
+		case CLOSURE_KIND: {
+			Closure* closure = obj;
+			closure->env = forward(closure->env);
+			forward_obj(&closure->body);
+			return;
+		}
+		default:
+			return;
+	}
 }
 
-void free_frame(Frame** frame) {
-	if (*frame == NULL)
-		return;
+/* code blocks whose constants are roots */
+
+CodeBlock* code_blocks;
+int code_block_count;
+int code_block_size;
 
-	Frame* temp = (*frame)->next;
-	free(*frame);
-	*frame = NULL;
-	free_frame(&temp);
+void register_code(Instr* code, int length) {
+	if (code_block_count == code_block_size) {
+		code_block_size = code_block_size ? code_block_size * 2 : 16;
+		code_blocks = realloc(code_blocks,
+						code_block_size * sizeof(CodeBlock));
+	}
+	code_blocks[code_block_count].code = code;
+	code_blocks[code_block_count].length = length;
+	code_block_count++;
 }
 
-void append_to_envs(Env* env) {
-	if (envs_tail)
-		envs_tail = envs_tail->next;
+void release_code(Instr* code) {
+	for (int i = 0; i < code_block_count; i++)
+		if (code_blocks[i].code == code) {
+			code_blocks[i] = code_blocks[--code_block_count];
+			free(code);
+			return;
+		}
+}
+
+void collect_garbage(void) {
+	size_t used = heap_used();
+			if (DEBUG) printf("collecting garbage (%zu bytes in use)...\n", used);
+
+	// everything might be live, so to_space has to hold all of it
+	to_space = make_chunk(used > HEAP_CHUNK_SIZE ? used : HEAP_CHUNK_SIZE);
+
+	/* roots */
+
+	for (int i = 0; i < reg_count; i++)
+		forward_obj(registers[i]);
+
+	for (int i = 0; i < stack_top; i++)
+		forward_obj(&stack[i]);
+
+	base_env = forward(base_env);
+
+	for (int i = 0; i < frame_top; i++)
+		frame_stack[i] = forward(frame_stack[i]);
+
+	for (int i = 0; i < code_block_count; i++)
+		for (int j = 0; j < code_blocks[i].length; j++)
+			forward_obj(&code_blocks[i].code[j].obj);
+
+	/* everything reachable from the roots */
+
+	for (int i = 0; i < kind_count; i++)
+		live_count[i] = 0;
+
+	char* scan = to_space->start;
+	while (scan < to_space->free) {
+		Header* header = (Header*) scan;
+		scan_object(header);
+		live_count[header->kind]++;
+		scan += sizeof(Header) + header->size;
+	}
+
+	/* flip */
+
+	while (heap) {
+		Chunk* temp = heap;
+		heap = heap->next;
+		free(temp);
+	}
+
+	for (int i = 0; i <= MAX_POOLED_SIZE / 8; i++)
+		free_cells[i] = NULL;
+
+	heap = to_space;
+	heap_capacity = to_space->end - to_space->start;
+	heap_live = to_space->free - to_space->start;
+	to_space = NULL;
+
+	// keep the heap at least twice the size of what survives
+	while (heap_live > heap_limit / 2)
+		heap_limit *= 2;
+
+	gc_pending = false;
+	gc_count++;
+			if (DEBUG) printf("%zu bytes live\n", heap_live);
+}
+
+/* end of session */
+
+void free_memory(void) {
+			if (DEBUG) printf("freeing memory...\n");
+
+	while (heap) {
+		Chunk* temp = heap;
+		heap = heap->next;
+		free(temp);
+	}
+	heap_capacity = 0;
 
-	envs_tail = malloc(sizeof(Env_list));
-	envs_tail->env = env;
-	envs_tail->next = NULL;
+	for (int i = 0; i <= MAX_POOLED_SIZE / 8; i++)
+		free_cells[i] = NULL;
 
-	if (!envs_head)
-		envs_head = envs_tail;
+	for (int i = 0; i < code_block_count; i++)
+		free(code_blocks[i].code);
+	free(code_blocks);
+	code_blocks = NULL;
+	code_block_count = code_block_size = 0;
 }
 
-/* tokens freed in parse.c */
\ No newline at end of file
+/* tokens freed in parse.c */
@@ -1,11 +1,51 @@
 /*
 	MEM
 
-	mem.c handles memory management. In particular,
-	it contains functions that free memory that has
-	been allocated via malloc.
-
-	Does any of this even work?
+	mem.c manages the heap. Everything the
+	evaluator builds at runtime (List cells,
+	frames, envs, closures, compiled procedures) is
+	allocated from it, and nothing is ever
+	freed by hand. Instead, when the heap fills
+	up, a stop-and-copy garbage collector (SICP
+	5.3.2) copies everything that's still
+	reachable into a fresh space and throws the
+	old one away.
+
+	Each heap object is preceded by a Header
+	that records what kind of object it is and
+	how big it is. That's what lets the collector
+	walk through the new space one object at a
+	time (SICP only has pairs, so it doesn't need
+	headers). When an object is moved, its Header
+	is overwritten with a 'broken heart' and its
+	first word with the forwarding address.
+
+	The roots are the seven registers, the stack,
+	base_env, the frame stack (see env.c), and the
+	constants in compiled code
+	(quoted data, parameter lists, lambda
+	expressions). Symbols aren't on the heap at
+	all, since they're interned for good.
+
+	Small objects that are known to be garbage
+	as soon as they're used (an arglist applied
+	to a primitive, the old frame in growFrame)
+	can be handed back with release. Freed cells go on
+	a free list for their size, and allocate takes
+	from the free list before carving a new cell
+	off the current chunk, so both are O(1). The
+	free lists live in from-space, so a collection
+	empties them.
+
+	Allocation never collects, since the caller
+	might be in the middle of building something
+	that isn't yet reachable from any root.
+	When the heap fills up, allocation just keeps
+	going in a new chunk and sets gc_pending.
+	The collection happens at the next safe point
+	(START or EVAL in the evaluator, procedure
+	entry in the VM), where everything live is
+	in the registers or on the stack.
 */
 
 #ifndef MEM_GUARD
@@ -13,40 +53,103 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "objects.h"
 #include "flags.h"
-#include "parse.h"
+#include "registers.h"
+#include "stack.h"
+#include "env.h"
+#include "vm.h"
+
+/* heap objects */
+
+typedef enum {
+	LIST_KIND,
+	PAIR_KIND,
+	FRAME_KIND,
+	ENV_KIND,
+	COMPILED_KIND,
+	CLOSURE_KIND,
+	FREE_CELL,
+	BROKEN_HEART,
+	kind_count
+} Kind;
+
+extern char* kind_names[kind_count];
+
+typedef struct Header Header;
+typedef struct Chunk Chunk;
+
+// size is the size of the object, not counting the header
+struct Header {
+	Kind kind;
+	int size;
+};
 
-void free_memory(void);
+struct Chunk {
+	Chunk* next;
+	char* free;
+	char* end;
+	char start[];
+};
 
-/* lists */
+void* allocate(Kind kind, size_t size);
+void release(void* obj);
 
-typedef struct List_list List_list;
+// the chunk at the head of the list is the one being allocated from
+extern Chunk* heap;
+Chunk* add_chunk(size_t size);
 
-struct List_list {
-	List* list;
-	List_list* next;
-};
+// a chunk that isn't part of the heap until it's linked in
+Chunk* make_chunk(size_t size);
+void link_chunk(Chunk* chunk);
 
-void free_lists(void);
-void free_list(List** list);
-void append_to_lists(List* list);
+// free lists are kept for sizes up to this (in bytes)
+#define MAX_POOLED_SIZE 256
 
-/* envs */
+/* counts of objects of each kind (for .stats). live
+	counts are exact right after a collection; in
+	between, they include garbage that hasn't been
+	found yet. */
 
-typedef struct Env_list Env_list;
+extern int live_count[kind_count];
+extern int allocated_count[kind_count];
 
-struct Env_list {
-	Env* env;
-	Env_list* next;
-};
+/* collection */
+
+extern bool gc_pending;
+extern int gc_count;
+extern size_t heap_limit;
+extern size_t heap_capacity;
+extern size_t heap_live;
+
+#define HEAP_CHUNK_SIZE (1 << 20)
+#define INITIAL_HEAP_LIMIT (4 << 20)
 
-void free_envs(void);
-void free_env(Env** env);
-void free_frame(Frame** frame);
-void append_to_envs(Env* env);
+void collect_garbage(void);
+size_t heap_used(void);
 
-/* tokens freed in parse.c */
+	void* forward(void* obj);
+	void forward_obj(Obj* obj);
+	void scan_object(Header* header);
+
+/* compiled code (see compile.c) */
+
+typedef struct {
+	Instr* code;
+	int length;
+} CodeBlock;
+
+extern CodeBlock* code_blocks;
+extern int code_block_count;
+
+void register_code(Instr* code, int length);
+void release_code(Instr* code);
+
+/* end of session */
+
+void free_memory(void);
 
-#endif
\ No newline at end of file
+#endif
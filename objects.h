@@ -20,14 +20,21 @@
 	two parts: a 'val' that holds the Obj's 'real'
 	value, and a 'tag' that says the type of the val.
 
-	The val is a union type called 'Val' which
-	provides for any possible type that the system
-	can handle. It can contain: a num (int), a name 
-	(char*), a List (a pointer to a linked list of 
-	Objs), a func (a pointer to a two-valued int
-	function), an env (a pointer to an Env, see 
+	The val can be any type that the system
+	can handle: a num (int), a name 
+	(a pointer to an interned Symbol, see symbol.c),
+	a List (a pointer to a linked list of 
+	Objs), a Pair (a cons cell whose cdr isn't
+	a list), a primitive (a pointer to a Prim,
+	see below), an env (a pointer to an Env, see 
 	env.c), a Label (an enum type corresponding to
-	the main function's goto labels), and two ints
+	the main function's goto labels), a Form (an
+	enum type naming a special form, see analyze.c),
+	a compound procedure (a pointer to a Closure,
+	see below), a compiled procedure and a code
+	address (pointers to a Compiled and an Instr,
+	see compile.c), and
+	two ints
 	indicating that the Obj is uninitialized or a
 	dummy (used for error checking). More types
 	can be added as needed.
@@ -37,43 +44,80 @@
 	for dispatching for functions that need to know
 	that, e.g. printf.
 
-	The stack is of type List, a pointer to a 
-	linked list of Objs. Objs can themselves contain
-	such pointers and bear the LIST tag.
-
-	There are several constructors. makeList mallocs
-	a List cell and returns a pointer to it. NUMOBJ, 
-	NAMEOBJ, and the rest are macros that expand to 
-	different applications of another macro called 
-	MKOBJ. MKOBJ in turn expands to an initialization 
-	of an OBJ. Such an initialization is both hard to 
-	read and annoying to type.
-
-	The Env type is included here because it's part
-	of Val, and the Frame type is included because
-	it's part of Env. See env.c for details.
-*/
-
-/*
-	TODO: edit to include description of Prims
+	That's the idea, anyway. In memory, an Obj is
+	a single machine word with the tag packed into
+	its low three bits. Everything an Obj can point
+	to is at least 8-byte aligned, so those bits
+	are always zero in a pointer, and the seven
+	pointer tags (LIST through CLOSURE) just get
+	or'ed in. LIST is 000, so a List pointer is
+	its own Obj and the empty list is all zeros.
+	The eighth pattern, 111, marks an immediate:
+	the next five bits hold the real tag (NUM,
+	LABEL, FORM, CODE, DUMMY or UNINIT) and the
+	rest of the word holds the value. A code
+	address is an immediate because it never
+	points into the heap, so the collector can
+	ignore it, just like a Label. This halves the size
+	of an Obj, a List cell and a stack slot. (It
+	assumes 64-bit words; on a 32-bit machine
+	numbers would only get 24 bits.)
+
+	The upshot is that an Obj has to be taken
+	apart with the selector macros (GETTAG, GETNUM,
+	GETLIST, etc) and put together with the
+	constructor macros (NUMOBJ, LISTOBJ, etc).
+	Nothing should touch the word directly.
+
+	The stack is an array of Objs (see stack.c).
+	Objs can themselves contain pointers to Lists
+	and bear the LIST tag.
+
+	makeList allocates a List cell and returns a
+	pointer to it. NUMOBJ, NAMEOBJ, and the rest
+	are macros that expand to PTROBJ or IMMOBJ,
+	which do the bit-fiddling.
+
+	A primitive function is a Prim, which says
+	what kind of C function it is (two ints to an
+	int, an Obj to an int, or an argument vector
+	to an Obj) along with the function itself. Prims live in
+	primitives.c and Objs point to them.
+
+	The Env type is included here because Objs can
+	point to it, and the Frame type is included
+	because it's part of Env. An arglist is an Env
+	too, whose frame doesn't have its keys filled in
+	yet. See env.c for details.
 */
 
 #ifndef OBJECTS_GUARD
 #define OBJECTS_GUARD
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /* typedefs */
 
-typedef union Val Val;
 typedef struct Obj Obj;
 typedef struct List List;
+typedef struct Pair Pair;
+
+typedef struct Symbol Symbol;
+
+typedef struct Binding Binding;
+typedef struct Frame Frame;
+typedef struct Env Env;
 
 typedef struct Prim Prim;
 typedef union primFunc primFunc;
 typedef int (*intFunc)(int, int);
 typedef int (*objFunc)(Obj);
+typedef Obj (*argsFunc)(Frame*);
 
-typedef struct Frame Frame;
-typedef struct Env Env;
+typedef struct Instr Instr;
+typedef struct Compiled Compiled;
+typedef struct Closure Closure;
 
 /* there are more labels, 
 but these are the ones that 
@@ -89,55 +133,97 @@ typedef enum {
 	_DID_LAST_ARG,
 	_SEQ_CONT,
 	_ALT_SEQ_CONT,
+	_RESUME_COMPILED,
 	label_count
 } Label;
 
+/* register names, for code that refers
+to registers as data (see compile.c) */
+
+typedef enum {
+	EXPR_REG,
+	VAL_REG,
+	CONT_REG,
+	FUNC_REG,
+	ARGLIST_REG,
+	UNEV_REG,
+	ENV_REG,
+	reg_count
+} Reg;
+
+/* special forms (keywords are replaced
+by these in analyze.c, which also marks
+references to global variables with
+GLOBAL_FORM, and in flat mode rewrites
+lambdas with FLAT_LAMBDA_FORM and their
+free variables with FREE_FORM) */
+
+typedef enum {
+	QUOTE_FORM,
+	LAMBDA_FORM,
+	BEGIN_FORM,
+	ASS_FORM,
+	DEF_FORM,
+	IF_FORM,
+	LOAD_FORM,
+	APP_FORM,
+	GLOBAL_FORM,
+	FLAT_LAMBDA_FORM,
+	FREE_FORM,
+	form_count
+} Form;
+
 /* primitive functions */
 
 typedef enum {
 	INTPRIM,
 	OBJPRIM,
+	ARGSPRIM,
 	primType_count
 } primType;
 
 union primFunc {
 	intFunc intfunc;
 	objFunc objfunc;
+	argsFunc argsfunc;
 };
 
+// arity is the number of arguments it takes
 struct Prim {
 	primType type;
+	int arity;
 	primFunc func;
 };
 
 /* objects */
 
+/* the pointer tags come first, and their
+values are their low three bits */
+
 typedef enum {
-	NUM,
-	NAME,
 	LIST,
+	NAME,
+	PAIR,
 	PRIM,
 	ENV,
+	COMPILED,
+	CLOSURE,
+	NUM,
 	LABEL,
+	FORM,
+	CODE,
 	DUMMY,
 	UNINIT,
 	tag_count
 } Tag;
 
-union Val {
-	int num;
-	char* name;
-	List* list;
-	Prim prim;
-	Env* env;
-	Label label;
-	int dummy;
-	int uninit;
-};
+#define TAG_BITS 3
+#define TAG_MASK ((uintptr_t) 7)
+#define IMMEDIATE 7
+#define IMMEDIATE_SHIFT 8
 
 struct Obj {
-	Tag	tag;
-	Val val;
+	uintptr_t word;
 };
 
 struct List {
@@ -145,17 +231,69 @@ struct List {
 	List* cdr;
 };
 
+/* a cons whose cdr isn't a list (see primitives.c) */
+
+struct Pair {
+	Obj car;
+	Obj cdr;
+};
+
+/* symbols (see symbol.c) */
+
+struct Symbol {
+	Symbol* next;
+	unsigned hash;
+	int id;
+	char name[];
+};
+
 /* frames and envs */
 
-struct Frame {
-	char* key;
+struct Binding {
+	Symbol* key;
 	Obj val;
-	Frame* next;
 };
 
+struct Frame {
+	int count;
+	int size;
+	Binding bindings[];
+};
+
+// the Ith value in an argument vector
+#define ARG(ARGS, I) ((ARGS)->bindings[I].val)
+
+// depth and captured are for reusing frames on
+// self tail calls (see reuseFrame in env.c)
 struct Env {
 	Frame* frame;
 	Env* enclosure;
+	int depth;
+	bool captured;
+};
+
+/* compound procedures (see makeFunc in llh.c): the
+params, body and env of a lambda in one allocation
+(body is the list of body expressions, straight from
+the lambda) */
+
+// params holds the parameters, then the internal defines
+struct Closure {
+	Env* env;
+	Obj body;
+	int param_count;
+	int local_count;
+	Symbol* params[];
+};
+
+/* compiled procedures (see compile.c and vm.c) */
+
+struct Compiled {
+	Instr* entry;
+	Env* env;
+	Obj params;
+	Obj body;
+	int local_count;
 };
 
 /* constructors and selectors */
@@ -173,36 +311,55 @@ struct Env {
 
 /* selectors */
 
-#define GETTAG(X) X.tag
-#define GETNUM(X) X.val.num
-#define GETNAME(X) X.val.name
-#define GETLIST(X) X.val.list
-// getprim
-#define GETENV(X) X.val.env
-#define GETLABEL(X) X.val.label
+#define GETTAG(X) ((((X).word & TAG_MASK) == IMMEDIATE) ? \
+	(Tag) (((X).word >> TAG_BITS) & 31) : (Tag) ((X).word & TAG_MASK))
+#define GETNUM(X) ((int) GETIMM(X))
+#define GETNAME(X) ((Symbol*) GETPTR(X))
+#define GETSTR(X) (GETNAME(X)->name)
+#define GETLIST(X) ((List*) (X).word)
+#define GETPAIR(X) ((Pair*) GETPTR(X))
+#define GETPRIM(X) ((Prim*) GETPTR(X))
+#define GETENV(X) ((Env*) GETPTR(X))
+#define GETLABEL(X) ((Label) GETIMM(X))
+#define GETFORM(X) ((Form) GETIMM(X))
+#define GETCOMPILED(X) ((Compiled*) GETPTR(X))
+#define GETCLOSURE(X) ((Closure*) GETPTR(X))
+#define GETCODE(X) ((Instr*) GETIMM(X))
+
+#define GETPTR(X) ((void*) ((X).word & ~TAG_MASK))
+#define GETIMM(X) ((intptr_t) (X).word >> IMMEDIATE_SHIFT)
 
 
 /* constructors */
 
 // Prim
 
-#define INTFUNC(X) MKPRIM(INTPRIM,intfunc, X)
-#define OBJFUNC(X) MKPRIM(OBJPRIM, objfunc, X)
+#define INTFUNC(X) MKPRIM(INTPRIM, 2, intfunc, X)
+#define OBJFUNC(X) MKPRIM(OBJPRIM, 1, objfunc, X)
+#define ARGSFUNC(X, ARITY) MKPRIM(ARGSPRIM, ARITY, argsfunc, X)
 
-#define MKPRIM(TYPE,FUNCTYPE,FUNC) (Prim){.type = TYPE, .func = (primFunc){.FUNCTYPE = FUNC}}
+#define MKPRIM(TYPE,ARITY,FUNCTYPE,FUNC) (Prim){.type = TYPE, .arity = ARITY, \
+	.func = (primFunc){.FUNCTYPE = FUNC}}
 
 // Obj
 
-#define NUMOBJ(X) MKOBJ(NUM, num, X)
-#define NAMEOBJ(X) MKOBJ(NAME, name, X)
-#define LISTOBJ(X) MKOBJ(LIST, list, X)
-#define PRIMOBJ(X) MKOBJ(PRIM, prim, X)
-#define ENVOBJ(X) MKOBJ(ENV, env, X)
-#define LABELOBJ(X) MKOBJ(LABEL, label, X)
-#define DUMMYOBJ MKOBJ(DUMMY, dummy, 0)
-#define UNINITOBJ MKOBJ(UNINIT, uninit, 0)
-
-#define MKOBJ(TAG,VALTYPE,VAL) (Obj){.tag = TAG, .val = (Val){.VALTYPE = VAL}}
+#define NUMOBJ(X) IMMOBJ(NUM, X)
+#define NAMEOBJ(X) PTROBJ(NAME, X)
+#define LISTOBJ(X) PTROBJ(LIST, X)
+#define PAIROBJ(X) PTROBJ(PAIR, X)
+#define PRIMOBJ(X) PTROBJ(PRIM, X)
+#define ENVOBJ(X) PTROBJ(ENV, X)
+#define LABELOBJ(X) IMMOBJ(LABEL, X)
+#define FORMOBJ(X) IMMOBJ(FORM, X)
+#define COMPILEDOBJ(X) PTROBJ(COMPILED, X)
+#define CLOSUREOBJ(X) PTROBJ(CLOSURE, X)
+#define CODEOBJ(X) IMMOBJ(CODE, X)
+#define DUMMYOBJ IMMOBJ(DUMMY, 0)
+#define UNINITOBJ IMMOBJ(UNINIT, 0)
+
+#define PTROBJ(TAG,PTR) ((Obj){(uintptr_t) (PTR) | (TAG)})
+#define IMMOBJ(TAG,VAL) ((Obj){((uintptr_t) (intptr_t) (VAL) << IMMEDIATE_SHIFT) | \
+	((uintptr_t) (TAG) << TAG_BITS) | IMMEDIATE})
 
 // List (defined in env.c)
 List* makeList(Obj car, List* cdr);
@@ -1,48 +1,32 @@
 #include "parse.h"
 
+OpenList* open_lists = NULL;
+int open_lists_size = 0;
+
 Obj process_code_text(char* expr) {
-	Token_list* tokens = tokenize(expr);
-	Obj parsed = parse(tokens);
-	// free_tokens(&tokens);
-	return parsed;
+	Reader reader = { .pos = expr, .end = expr + strlen(expr) };
+	return read_form(&reader);
 }
 
-// TODO: special case for nonlist expr (???)
-Token_list* tokenize(char* expr) {
-			if (DEBUG) printf("%s\n", "tokenizing...");
-	State state = READY;
-
-	int length = strlen(expr);
-	if (length == 0) return NULL;
-
-	int i = 0;
-	char c;
+Obj read_form(Reader* reader) {
+			if (DEBUG) printf("%s\n", "reading...");
 
-	Token_list* tokens = malloc(sizeof(Token_list)); // initialize to NULL?
-	Token_list* tail = tokens;
-	tail->next = NULL;
+	char* pos = reader->pos;
+	char* end = reader->end;
+	int depth = 0;
 
 	// temporary variables
-	int start;
-	int end;
-	int sub_length;
-	char* text;
-
-	// debugging
-	// Token_list* temp = tokens;
-	// int parens = 0;
+	char c;
+	char* start;
+	int num;
+	Obj obj;
+	List* cell;
 
 	START:
-		if (i >= length) {
-			if (state == SYMBOL) {
-				goto END_TEXT;
-			}
-			goto DONE;
-		}
-
-		c = expr[i];
+		if (pos == end)
+			goto END_TEXT;
 
-		// TODO: special case for nonlist expr (???)
+		c = *pos;
 
 		if (OPENPAREN(c))
 			goto OPEN;
@@ -50,219 +34,79 @@ Token_list* tokenize(char* expr) {
 			goto CLOSE;
 		if (WHITESPACE(c))
 			goto SEPARATOR;
+		if (COMMENT(c))
+			goto SKIP_COMMENT;
 
-		/* default case is any other char
-		so no other if clause is needed? */
-		// if (isalnum(c))
+		/* default case is any other char */
 			goto TEXT;
 
-	OPEN://printf("%d @ %s\n", state, "OPEN");
-		if (state == SYMBOL)
-			goto END_TEXT;
-		tail->token.start = i;
-		tail->token.end = i + 1;
-		tail->token.id = OP;
-		tail->token.text = "OPEN";
-		tail->next = malloc(sizeof(Token_list));
-		tail = tail->next;
-		tail->next = NULL;
-		i++;
+	OPEN:
+		if (depth == open_lists_size) {
+			open_lists_size = open_lists_size ?
+				2 * open_lists_size : INITIAL_READ_DEPTH;
+			open_lists = realloc(open_lists,
+							open_lists_size * sizeof(OpenList));
+		}
+		open_lists[depth].head = NULL;
+		open_lists[depth].last = NULL;
+		depth++;
+		pos++;
 		goto START;
 
-	CLOSE://printf("%d @ %s\n", state, "CLOSE");
-		if (state == SYMBOL)
-			goto END_TEXT;
-		tail->token.start = i;
-		tail->token.end = i + 1;
-		tail->token.id = CP;
-		tail->token.text = "CLOSE";
-		// what should this value be???
-		if (i < length - 2) {
-			tail->next = malloc(sizeof(Token_list));
-			tail = tail->next;
-			tail->next = NULL;
+	CLOSE:
+		pos++;
+		if (depth == 0) {
+			printf("%s\n", "unexpected close paren -- read_form");
+			error_count++;
+			goto START;
 		}
-		i++;
-		goto START;
+		depth--;
+		obj = LISTOBJ(open_lists[depth].head);
+		goto ELEMENT;
 
-	SEPARATOR://printf("%d @ %s\n", state, "SEPARATOR");
-		if (state == SYMBOL)
-			goto END_TEXT;
-		i++;
+	SEPARATOR:
+		pos++;
 		goto START;
 
-	TEXT://printf("%d @ %s\n", state, "TEXT");
-		if (state == READY) {
-			state = SYMBOL;
-			tail->token.id = SYM;
-			tail->token.start = i;
-		}
-		i++;
+	SKIP_COMMENT: // to the end of the line
+		while (pos < end && *pos != '\n')
+			pos++;
 		goto START;
 
-	END_TEXT://printf("%d @ %s\n", state, "END_TEXT");
-		tail->token.end = i;
-		start = tail->token.start;
-		end = tail->token.end;
-		sub_length = end - start;
-		text = malloc(sub_length * sizeof(char));
-		strncpy(text, expr + start, sub_length);
-		text[sub_length] = '\0';	
-		tail->token.text = text;
-		if (i < length - 1) {
-			tail->next = malloc(sizeof(Token_list));
-			tail = tail->next;
-			tail->next = NULL;
+	TEXT:
+		start = pos;
+		pos = scan_name(pos, end);
+		if (isdigit(*start))
+			goto NUMBER;
+		// no copy: the text is interned
+		obj = NAMEOBJ(intern_n(start, pos - start));
+		goto ELEMENT;
+
+	NUMBER: // like atoi, but it stops at pos
+		num = 0;
+		for (; start < pos && isdigit(*start); start++)
+			num = 10 * num + (*start - '0');
+		obj = NUMOBJ(num);
+		// fall through to ELEMENT
+
+	ELEMENT:
+		if (depth == 0) {
+			reader->pos = pos;
+			return obj;
 		}
-		state = READY;
+		cell = makeList(obj, NULL);
+		if (open_lists[depth - 1].last)
+			open_lists[depth - 1].last->cdr = cell;
+		else
+			open_lists[depth - 1].head = cell;
+		open_lists[depth - 1].last = cell;
 		goto START;
 
-	DONE:
-				if (DEBUG) print_tokens(tokens);
-		return tokens;
-}	
-
-
-Obj parse(Token_list* tokens) {
-			if (DEBUG) { printf("%s\n", "parsing..."); print_tokens(tokens); }
-
-	if (tokens == NULL) {
-		printf("%s\n", "no tokens -- read_from_tokens");
-		exit(1);
-	}
-
-	Obj obj; 
-	Token token = tokens->token;
-
-	// code is a name or number
-	if (token.id == SYM) {
-		// if (DEBUG) printf("token: %s\n", token.text);
-		char* text = token.text;
-		if (isdigit(text[0])) 
-			obj = NUMOBJ(atoi(text));
-		else 
-			obj = NAMEOBJ(text);
-		return obj;
-	}
-
-	// code is a list
-	List* result = NULL;
-	Token_list* remainder = slice_ends(&tokens);
-
-	Token_list* head = NULL;
-	Token_list* tail = NULL;
-
-	int op = 0;
-	int cp = 0;
-
-	while (remainder) {
-		Token first = remainder->token;
-
-		// first item is an atom
-		if (first.id == SYM) { 
-			// wrap first (Token) in a Token_list to pass to parse
-			Token_list dummy;
-			dummy.next = NULL;
-			dummy.token = first;
-			push(parse(&dummy), &result);
-
-				// do we need this?
-			// if (remainder->next == NULL)
-			// 	return result;
-			// else
-				remainder = remainder->next;
+	END_TEXT:
+		reader->pos = pos;
+		if (depth) {
+			printf("%s\n", "missing close paren -- read_form");
+			error_count++;
 		}
-
-		// first item is a list
-		else {
-			op = 1;
-			cp = 0;
-			head = remainder;
-			tail = remainder;
-			while (op > cp) { // this will terminate if code is wellformed
-				tail = tail->next;
-				if (tail->token.id == OP)
-					op++;
-				if (tail->token.id == CP)
-					cp++;
-			}
-			remainder = tail->next;
-			tail->next = NULL;
-			push(parse(head), &result);
-		} 
-	}
-
-	// record memory usage
-	append_to_lists(result);
-	// if (!lists_head)
-	// 	lists_head = lists_tail;
-
-	obj = LISTOBJ(result);
-	return obj;
-}
-
-
-/* list manipulation */
-
-// token list
-void dock(Token_list** list) {
-	if (*list == NULL) return;
-	
-	else if ((*list)->next == NULL) {
-		free(*list);
-		*list = NULL;
-		return;
-	}
-	
-	else dock(&((*list)->next));
+		return DUMMYOBJ;
 }
-
-Token_list* slice_ends(Token_list** list) {
-	Token_list* sliced = (*list)->next;
-	free(*list);
-	*list = NULL;
-	dock(&sliced);
-	return sliced;
-}
-
-// obj list
-void push(Obj obj, List** list) {
-	if (*list == NULL) {
-		*list = malloc(sizeof(List));
-		(*list)->car = obj;
-		(*list)->cdr = NULL;
-		return;
-	}
-
-	else push(obj, &((*list)->cdr));
-}
-
-/* for debugging */
-
-void print_tokens(Token_list* tokens) {
-	printf("printing tokens...\n");
-
-	while (tokens) {
-		printf("text: %s\n", tokens->token.text);
-		printf("next: %p\n", tokens->next);
-		tokens = tokens->next;
-	}
-
-	printf("tokens printed!\n");
-	return;
-}
-
-/* memory management */
-
-void free_tokens(Token_list** list) {
-			if (DEBUG) printf("freeing tokens...\n");
-
-	if (*list == NULL)
-		return;
-
-	Token_list* temp = *list;
-	*list = (*list)->next;
-	free(temp);
-	temp = NULL;
-	free_tokens(list);
-}
\ No newline at end of file
@@ -1,36 +1,41 @@
 /*
 	PARSE
 
-	tokenize is a classic finite state automaton
-	for "tokenizing" (i.e. determining the basic
-	meaningful pieces of) the input code string.
-	Because Lisp syntax is so brilliantly simple
-	(only parentheses and whitespace are syntactically
-	significant), the FSA has only two "states".
-	It is implemented entirely with GOTOs, with no
-	function calls at all!***
+	read_form is a classic finite state automaton
+	for reading Lisp code. Because Lisp syntax is
+	so brilliantly simple (only parentheses,
+	whitespace and ; comments are syntactically
+	significant), it
+	doesn't need a separate tokenizer: it walks
+	the code string once, character by character,
+	and builds Objs as it goes. It is implemented
+	entirely with GOTOs, with no function calls at
+	all!***
 
 	*** Actually, it uses the C standard library,
-	but still, it makes no calls to user-defined
-	functions.
-
-	tokenize generates a list of tokens which is
-	then passed to parse. parse, in turn, generates
-	a basic abstract syntax tree. again, because
-	Lisp syntax is so simple, no further analysis
-	is needed. parse generates a single Obj, which
-	may itself contain a List of Objs (see objects.h
-	for details).
-
-	parse mixes iteration and recursion -- it walks
-	down the token list and recurs when it finds
-	a list. Is that what recursive descent is?
-*/
-
-/*
-	TODO:
-		-- figure out memory management
-			-- free_tokens doesn't mix with library?
+	and calls intern_n and makeList to build the
+	Objs, but still, it makes no other calls to
+	user-defined functions.
+
+	A name or number is made as soon as its last
+	character is read. An open paren pushes a new
+	list onto an explicit stack of open lists, each
+	element read is hung onto the end of the list
+	on top of the stack (the stack keeps a pointer
+	to its last cell, so that's O(1)), and a close
+	paren pops the list and treats it as an element
+	of the one below. When the stack is empty, the
+	form is done. So every character is looked at
+	once, and the only allocation is the List cells
+	of the result (and the stack, which is kept
+	from one form to the next). The end of a name
+	is found a block of characters at a time (see
+	scan.h).
+
+	A Reader holds the position in a code string,
+	so the forms in a string can be read one after
+	another. process_code_text reads the first form
+	of a string.
 */
 
 #ifndef PARSE_GUARD
@@ -44,54 +49,28 @@
 #include "objects.h"
 #include "keywords.h"
 #include "flags.h"
-#include "mem.h"
-
-/*
-	Token and Token_list types, passed
-	from tokenize to parse, and prototypes
-*/
-
-/* tokens */
-
-typedef struct Token Token;
-typedef struct Token_list Token_list;
-
-typedef enum {
-	OP,
-	CP,
-	SYM,
-	tokenid_count
-} TokenID;
+#include "symbol.h"
+#include "scan.h"
 
-typedef enum {
-	READY,
-	SYMBOL,
-	state_count
-} State;
+typedef struct Reader Reader;
 
-struct Token {
-	int start;
-	int end;
-	TokenID id;
-	char* text;
+struct Reader {
+	char* pos;
+	char* end;
 };
 
-struct Token_list {
-	Token token;
-	Token_list* next;
-};
+/* lists that have been opened but not closed */
 
-// prototypes
-Obj process_code_text(char* expr);
-Token_list* tokenize(char* expr);
-Obj parse(Token_list* tokens);
+typedef struct {
+	List* head;
+	List* last;
+} OpenList;
 
-void dock(Token_list** list);
-Token_list* slice_ends(Token_list** list);
-void push(Obj obj, List** list);
+#define INITIAL_READ_DEPTH 64
 
-void print_tokens(Token_list* tokens);
+Obj process_code_text(char* expr);
 
-void free_tokens(Token_list** list);
+// returns DUMMYOBJ when there are no more forms
+Obj read_form(Reader* reader);
 
-#endif
\ No newline at end of file
+#endif
@@ -11,35 +11,85 @@ intFunc eq_;
 List* primitive_vars(void) {
 
 	List* prim_arith_vars = 
-		makeList(NAMEOBJ(PRIM_ADD), 
-			makeList(NAMEOBJ(PRIM_SUB), 
-				makeList(NAMEOBJ(PRIM_MUL), 
-					makeList(NAMEOBJ(PRIM_DIV), 
-						makeList(NAMEOBJ(PRIM_EQ), NULL)))));
-
-	List* vars = prim_arith_vars;
+		makeList(NAMEOBJ(intern(PRIM_ADD)), 
+			makeList(NAMEOBJ(intern(PRIM_SUB)), 
+				makeList(NAMEOBJ(intern(PRIM_MUL)), 
+					makeList(NAMEOBJ(intern(PRIM_DIV)), 
+						makeList(NAMEOBJ(intern(PRIM_EQ)), NULL)))));
+
+	List* prim_pair_vars = 
+		makeList(NAMEOBJ(intern(PRIM_CONS)), 
+			makeList(NAMEOBJ(intern(PRIM_CAR)), 
+				makeList(NAMEOBJ(intern(PRIM_CDR)), 
+					makeList(NAMEOBJ(intern(PRIM_SET_CAR)), 
+						makeList(NAMEOBJ(intern(PRIM_SET_CDR)), 
+							makeList(NAMEOBJ(intern(PRIM_PAIR)), 
+								makeList(NAMEOBJ(intern(PRIM_NULL)), 
+									prim_arith_vars)))))));
+
+	List* vars = prim_pair_vars;
 
 	return vars;
 }
 
-/* primitive values */
+/* primitive values (Objs point to these) */
+
+Prim addprim;
+Prim subprim;
+Prim mulprim;
+Prim divprim;
+Prim eqprim;
+Prim consprim;
+Prim carprim;
+Prim cdrprim;
+Prim setcarprim;
+Prim setcdrprim;
+Prim pairprim;
+Prim nullprim;
+
+// images refer to primitives by their place in here (see image.c)
+Prim* prim_table[] = {
+	&addprim, &subprim, &mulprim, &divprim, &eqprim,
+	&consprim, &carprim, &cdrprim, &setcarprim, &setcdrprim,
+	&pairprim, &nullprim
+};
+
+int prim_count = sizeof(prim_table) / sizeof(Prim*);
 
 List* primitive_vals(void) {
 
-	Prim addprim = INTFUNC(add_);
-	Prim subprim = INTFUNC(sub_);
-	Prim mulprim = INTFUNC(mul_);
-	Prim divprim = INTFUNC(div_);
-	Prim eqprim = INTFUNC(eq_);
+	addprim = INTFUNC(add_);
+	subprim = INTFUNC(sub_);
+	mulprim = INTFUNC(mul_);
+	divprim = INTFUNC(div_);
+	eqprim = INTFUNC(eq_);
 
 	List* prim_arith_vals = 
-		makeList(PRIMOBJ(addprim), 
-			makeList(PRIMOBJ(subprim), 
-				makeList(PRIMOBJ(mulprim), 
-					makeList(PRIMOBJ(divprim), 
-						makeList(PRIMOBJ(eqprim), NULL)))));
-
-	List* vals = prim_arith_vals;
+		makeList(PRIMOBJ(&addprim), 
+			makeList(PRIMOBJ(&subprim), 
+				makeList(PRIMOBJ(&mulprim), 
+					makeList(PRIMOBJ(&divprim), 
+						makeList(PRIMOBJ(&eqprim), NULL)))));
+
+	consprim = ARGSFUNC(cons_func, 2);
+	carprim = ARGSFUNC(car_func, 1);
+	cdrprim = ARGSFUNC(cdr_func, 1);
+	setcarprim = ARGSFUNC(set_car_func, 2);
+	setcdrprim = ARGSFUNC(set_cdr_func, 2);
+	pairprim = OBJFUNC(pair_func);
+	nullprim = OBJFUNC(null_func);
+
+	List* prim_pair_vals = 
+		makeList(PRIMOBJ(&consprim), 
+			makeList(PRIMOBJ(&carprim), 
+				makeList(PRIMOBJ(&cdrprim), 
+					makeList(PRIMOBJ(&setcarprim), 
+						makeList(PRIMOBJ(&setcdrprim), 
+							makeList(PRIMOBJ(&pairprim), 
+								makeList(PRIMOBJ(&nullprim), 
+									prim_arith_vals)))))));
+
+	List* vals = prim_pair_vals;
 
 	return vals;
 }
@@ -47,14 +97,101 @@ List* primitive_vals(void) {
 /* primitive type-checking */
 
 int null_func(Obj obj) {
-	int isList = obj.tag == LIST;
-	int isNull = obj.val.list == NULL;
+	int isList = GETTAG(obj) == LIST;
+	int isNull = GETLIST(obj) == NULL;
 
 	return isList && isNull;
 }
 
 objFunc null_ = null_func;
 
+int pair_func(Obj obj) {
+	int isCell = GETTAG(obj) == LIST && GETLIST(obj) != NULL;
+	int isPair = GETTAG(obj) == PAIR;
+
+	return isCell || isPair;
+}
+
+/* primitive pairs */
+
+Pair* makePair(Obj car, Obj cdr) {
+	Pair* pair = allocate(PAIR_KIND, sizeof(Pair));
+	pair->car = car;
+	pair->cdr = cdr;
+	return pair;
+}
+
+Obj cons_func(Frame* args) {
+	Obj car = ARG(args, 0);
+	Obj cdr = ARG(args, 1);
+
+	if (GETTAG(cdr) == LIST)
+		return LISTOBJ(makeList(car, GETLIST(cdr)));
+	else
+		return PAIROBJ(makePair(car, cdr));
+}
+
+Obj car_func(Frame* args) {
+	Obj obj = ARG(args, 0);
+
+	if (GETTAG(obj) == LIST && GETLIST(obj) != NULL)
+		return GETLIST(obj)->car;
+	if (GETTAG(obj) == PAIR)
+		return GETPAIR(obj)->car;
+
+	printf("car: not a pair!\n");
+	error_count++;
+	return DUMMYOBJ;
+}
+
+Obj cdr_func(Frame* args) {
+	Obj obj = ARG(args, 0);
+
+	if (GETTAG(obj) == LIST && GETLIST(obj) != NULL)
+		return LISTOBJ(GETLIST(obj)->cdr);
+	if (GETTAG(obj) == PAIR)
+		return GETPAIR(obj)->cdr;
+
+	printf("cdr: not a pair!\n");
+	error_count++;
+	return DUMMYOBJ;
+}
+
+Obj set_car_func(Frame* args) {
+	Obj obj = ARG(args, 0);
+	Obj val = ARG(args, 1);
+
+	if (GETTAG(obj) == LIST && GETLIST(obj) != NULL)
+		GETLIST(obj)->car = val;
+	else if (GETTAG(obj) == PAIR)
+		GETPAIR(obj)->car = val;
+	else {
+		printf("set-car!: not a pair!\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
+
+	return val;
+}
+
+// the cdr of a List cell can only be another list
+Obj set_cdr_func(Frame* args) {
+	Obj obj = ARG(args, 0);
+	Obj val = ARG(args, 1);
+
+	if (GETTAG(obj) == LIST && GETLIST(obj) != NULL && GETTAG(val) == LIST)
+		GETLIST(obj)->cdr = GETLIST(val);
+	else if (GETTAG(obj) == PAIR)
+		GETPAIR(obj)->cdr = val;
+	else {
+		printf("set-cdr!: can't set that cdr!\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
+
+	return val;
+}
+
 /* primitive arithmetic */
 
 int add_func(int a, int b) {
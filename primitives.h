@@ -1,13 +1,19 @@
 #ifndef PRIMITIVES_GUARD
 #define PRIMITIVES_GUARD
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "objects.h"
+#include "symbol.h"
+#include "mem.h"
 
 List* primitive_vars(void);
 List* primitive_vals(void);
 
+extern Prim* prim_table[];
+extern int prim_count;
+
 /* primitive arithmetic functions */
 
 #define PRIM_ADD "+"
@@ -16,4 +22,33 @@ List* primitive_vals(void);
 #define PRIM_DIV "/"
 #define PRIM_EQ "=" 
 
+/*
+	primitive pair functions. cons makes an
+	ordinary List cell when its second argument
+	is a list (so consed lists and quoted lists
+	are the same thing), and a Pair otherwise.
+	car and cdr take either. Build with
+	-DLAMBDA_PAIRS to get the old lambda-encoded
+	cons, car and cdr from lib.c instead (they
+	shadow these).
+*/
+
+#define PRIM_CONS "cons"
+#define PRIM_CAR "car"
+#define PRIM_CDR "cdr"
+#define PRIM_SET_CAR "set-car!"
+#define PRIM_SET_CDR "set-cdr!"
+#define PRIM_PAIR "pair?"
+#define PRIM_NULL "null?"
+
+Obj cons_func(Frame* args);
+Obj car_func(Frame* args);
+Obj cdr_func(Frame* args);
+Obj set_car_func(Frame* args);
+Obj set_cdr_func(Frame* args);
+int pair_func(Obj obj);
+int null_func(Obj obj);
+
+Pair* makePair(Obj car, Obj cdr);
+
 #endif
\ No newline at end of file
@@ -16,6 +16,13 @@ void print_stats(void) {
 	printf("*** STATS ***\n");
 	printf("Total number of saves: %d\n", save_count);
 	printf("Maximum stack depth: %d\n", max_stack_depth);
+	printf("Symbol table: %d symbols, %zu bytes\n",
+		symbol_count, symbol_memory());
+	printf("Heap: %zu bytes in use, %zu live after %d collections\n",
+		heap_used(), heap_live, gc_count);
+	for (int i = 0; i < FREE_CELL; i++)
+		printf("  %s: %d live, %d allocated\n",
+			kind_names[i], live_count[i], allocated_count[i]);
 	reset_stats();
 }
 
@@ -53,14 +60,13 @@ void print_registers(void) {
 void print_stack(void) {
 	PRDIV;
 	// printf("%s\n", "printing stack...");
-	List* temp = stack;
 	int count = 0;
-	if (!temp)
+	if (stack_top == 0)
 		printf("%s\n", "-- EMPTY STACK --");
-	while (temp) {
+	// from the top down
+	for (int i = stack_top - 1; i >= 0; i--) {
 		printf("-- STACK ENTRY %d -- \n", count);
-		print_obj(temp->car); NL;
-		temp = temp->cdr;
+		print_obj(stack[i]); NL;
 		count++;
 	}
 	PRDIV;
@@ -72,12 +78,29 @@ void print_obj(Obj obj) {
 			printf("%d ", GETNUM(obj));
 			break;
 		case NAME:
-			printf("%s ", GETNAME(obj));
+			printf("%s ", GETSTR(obj));
 			break;
 		case LIST:
+			// global references print as plain names
+			if (isGlobalRef(obj)) {
+				print_obj(globalName(obj));
+				break;
+			}
+			if (isFreeRef(obj)) {
+				print_obj(freeName(obj));
+				break;
+			}
 			printf("%s", "( ");
+			if (GETLIST(obj) && isAnyLambda(obj)) {
+				print_lambda(GETLIST(obj));
+				break;
+			}
 			print_list(GETLIST(obj));
 			break;
+		case PAIR:
+			printf("%s", "( ");
+			print_pair(GETPAIR(obj));
+			break;
 		case PRIM:
 			printf("__%s__ ", 
 				lookup_prim_name(obj));
@@ -88,6 +111,18 @@ void print_obj(Obj obj) {
 		case LABEL:
 			print_label(GETLABEL(obj));
 			break;
+		case FORM:
+			print_form(GETFORM(obj));
+			break;
+		case COMPILED:
+			print_compiled(GETCOMPILED(obj));
+			break;
+		case CLOSURE:
+			print_closure(GETCLOSURE(obj));
+			break;
+		case CODE:
+			printf("<code %p> ", GETCODE(obj));
+			break;
 		case DUMMY:
 			printf("%s ", "???");
 			break;
@@ -102,12 +137,41 @@ void print_obj(Obj obj) {
 }
 
 void print_list(List* list) {
-	if (list == NULL) {
-		printf("%s", ") ");
+	for (; list; list = list->cdr)
+		print_obj(list->car);
+	printf("%s", ") ");
+}
+
+// without the lists analyze.c added (locals, and
+// the captures of a flat lambda)
+void print_lambda(List* lambda) {
+	print_obj(CAR(lambda));
+	if (CDR(lambda) == NULL) {
+		print_list(NULL);
 		return;
 	}
-	print_obj(list->car);
-	print_list(list->cdr);
+	print_obj(CADR(lambda));
+	List* body = CDDDR(lambda);
+	if (hasForm(LISTOBJ(lambda), FLAT_LAMBDA_FORM))
+		body = CDR(body);
+	print_list(body);
+}
+
+// a chain of pairs ends in a list or a dotted cdr
+void print_pair(Pair* pair) {
+	print_obj(pair->car);
+	switch (GETTAG(pair->cdr)) {
+		case PAIR:
+			print_pair(GETPAIR(pair->cdr));
+			break;
+		case LIST:
+			print_list(GETLIST(pair->cdr));
+			break;
+		default:
+			printf("%s", ". ");
+			print_obj(pair->cdr);
+			printf("%s", ") ");
+	}
 }
 
 void print_label(Label label) {
@@ -139,62 +203,120 @@ void print_label(Label label) {
 		case _ALT_SEQ_CONT:
 			printf("ALT_SEQ_CONT ");
 			break;
+		case _RESUME_COMPILED:
+			printf("RESUME_COMPILED ");
+			break;
 		default:
 			printf("UNKNOWN LABEL ");
 	}
 }
 
-extern Env* base_env;
-
-char* lookup_prim_name(Obj func_obj) {
-	// dispatch on primitive function type
-	primType type = func_obj.val.prim.type;
-
-	intFunc lookup_intfunc;
-	intFunc val_intfunc;
+// forms print as the keywords they replaced
+void print_form(Form form) {
+	switch(form) {
+		case QUOTE_FORM:
+			printf("%s ", QUOTE_KEY);
+			break;
+		case LAMBDA_FORM:
+		case FLAT_LAMBDA_FORM:
+			printf("%s ", FUN_KEY);
+			break;
+		case BEGIN_FORM:
+			printf("%s ", BEGIN_KEY);
+			break;
+		case ASS_FORM:
+			printf("%s ", ASS_KEY);
+			break;
+		case DEF_FORM:
+			printf("%s ", DEF_KEY);
+			break;
+		case IF_FORM:
+			printf("%s ", IF_KEY);
+			break;
+		case LOAD_FORM:
+			printf("%s ", LOAD_KEY);
+			break;
+		default:
+			printf("UNKNOWN FORM ");
+	}
+}
 
-	objFunc lookup_objfunc;
-	objFunc val_objfunc;
+// looks like an interpreted procedure, but with a different head
+// prints the lambda the closure was made from, plus its env
+void print_closure(Closure* closure) {
+	printf("%s", "( lambda ( ");
+	for (int i = 0; i < closure->param_count; i++)
+		printf("%s ", closure->params[i]->name);
+	printf("%s", ") ");
+	for (List* body = GETLIST(closure->body); body; body = body->cdr)
+		print_obj(body->car);
+	printf("%p ) ", closure->env);
+}
 
-	primType val_type;
+void print_compiled(Compiled* compiled) {
+	printf("%s", "( compiled ");
+	print_obj(compiled->params);
+	for (List* body = GETLIST(compiled->body); body; body = body->cdr)
+		print_obj(body->car);
+	printf("%p ) ", compiled->env);
+}
 
-	if (type == INTPRIM) 
-		lookup_intfunc = func_obj.val.prim.func.intfunc;
+char* op_names[op_count] = {
+	[ASSIGN_CONST] = "ASSIGN_CONST",
+	[ASSIGN_REG] = "ASSIGN_REG",
+	[ASSIGN_LABEL] = "ASSIGN_LABEL",
+	[LEXICAL_LOOKUP] = "LEXICAL_LOOKUP",
+	[GLOBAL_LOOKUP] = "GLOBAL_LOOKUP",
+	[MAKE_COMPILED] = "MAKE_COMPILED",
+	[COMPILED_ENV] = "COMPILED_ENV",
+	[EXTEND_ENV] = "EXTEND_ENV",
+	[MAKE_ARGS] = "MAKE_ARGS",
+	[APPLY_PRIM] = "APPLY_PRIM",
+	[LOAD_FILE] = "LOAD_FILE",
+	[SET_ARG] = "SET_ARG",
+	[DEFINE_VAR] = "DEFINE_VAR",
+	[SET_VAR] = "SET_VAR",
+	[LEXICAL_SET] = "LEXICAL_SET",
+	[GLOBAL_SET] = "GLOBAL_SET",
+	[TEST_FALSE] = "TEST_FALSE",
+	[TEST_PRIM] = "TEST_PRIM",
+	[TEST_COMPILED] = "TEST_COMPILED",
+	[BRANCH] = "BRANCH",
+	[GOTO_LABEL] = "GOTO_LABEL",
+	[GOTO_REG] = "GOTO_REG",
+	[GOTO_ENTRY] = "GOTO_ENTRY",
+	[APPLY_INTERP] = "APPLY_INTERP",
+	[SAVE] = "SAVE",
+	[RESTORE] = "RESTORE",
+	[LABEL_MARK] = "LABEL_MARK",
+};
+
+void print_instr(Instr* instr) {
+	printf("%p: %s %s ", instr,
+		op_names[instr->op],
+		register_names[instr->target]);
+	if (GETTAG(instr->obj) != UNINIT)
+		print_obj(instr->obj);
+	if (instr->op == LEXICAL_LOOKUP || instr->op == LEXICAL_SET)
+		printf("(%d, %d) ", instr->depth, instr->offset);
+	if (instr->op == MAKE_ARGS || instr->op == SET_ARG ||
+			instr->op == EXTEND_ENV)
+		printf("[%d] ", instr->offset);
+	if (instr->label)
+		printf("-> %p", instr->label);
+}
 
-	else if (type == OBJPRIM) 
-		lookup_objfunc = func_obj.val.prim.func.objfunc;
+extern Env* base_env;
 
+// each primitive is a single Prim, so the pointers identify it
+char* lookup_prim_name(Obj func_obj) {
+	Prim* prim = GETPRIM(func_obj);
 	Frame* frame = base_env->frame;
-	Obj val;
-	char* key;
-
-	while (frame) {
-
-		val = frame->val;
-
-		if (val.tag == PRIM) {
-			val_type = val.val.prim.type;
-
-			if (val_type == INTPRIM) {
-				val_intfunc = val.val.prim.func.intfunc;
-				key = frame->key;
-				if (lookup_intfunc == val_intfunc)
-					return key;
-			}
-
-			else if (val_type == OBJPRIM) {
-				val_objfunc = val.val.prim.func.objfunc;
-				key = frame->key;
-				if (lookup_objfunc == val_objfunc)
-					return key;
-			}
-
-			// val_func = val.val.prim;
-			// if (lookup_func == val_func)
-				// return key;
-		}
 
-		frame = frame->next;
+	for (int i = 0; i < frame->count; i++) {
+		Obj val = frame->bindings[i].val;
+		if (GETTAG(val) == PRIM && GETPRIM(val) == prim)
+			return frame->bindings[i].key->name;
 	}
 
 	return "unknown primitive function...";
@@ -219,8 +341,13 @@ void print_help(void) {
 	TAB;printf("-- enter .step to toggle step mode (pauses between each step of the evaluator in info mode)");NL;
 	TAB;printf("-- enter .stats to toggle stack stats mode");NL;
 	TAB;printf("-- enter .tail to toggle tail recursion mode (turning this off is really only of any interest in conjunction with stats mode)");NL;
+	TAB;printf("-- enter .compile to toggle compile mode (compiles input before running it)");NL;
+	TAB;printf("-- enter .flat to toggle flat closure mode (interpreted lambdas copy just the variables they use, instead of keeping the whole env)");NL;
 	TAB;printf("-- enter .debug to toggle debug mode");NL;
-	TAB;printf("-- enter .quit to quit");NL;NL;
+	TAB;printf("-- enter (load \"path\") to run the code in a file");NL;
+	TAB;printf("-- enter .quit to quit");NL;
+	TAB;printf("-- call lispinc with --batch or --interactive to choose the mode (piped input and files mean batch)");NL;
+	TAB;printf("-- call lispinc with --dump-image FILE to save everything defined to FILE on the way out, and with --image FILE to start from it");NL;NL;
 }
 
 void print_flags(void) {
@@ -230,5 +357,7 @@ void print_flags(void) {
 	TAB;printf("STEP  :%s", STEP ? "ON" : "OFF");NL
 	TAB;printf("STATS :%s", STATS ? "ON" : "OFF");NL
 	TAB;printf("TAIL  :%s", TAIL ? "ON" : "OFF");NL
+	TAB;printf("COMPILE :%s", COMPILE ? "ON" : "OFF");NL
+	TAB;printf("FLAT  :%s", FLAT ? "ON" : "OFF");NL
 	TAB;printf("DEBUG :%s", DEBUG ? "ON" : "OFF");NL
 }
\ No newline at end of file
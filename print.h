@@ -23,6 +23,9 @@
 #include "flags.h"
 #include "registers.h"
 #include "stack.h"
+#include "vm.h"
+#include "symbol.h"
+#include "mem.h"
 
 #define NL printf("\n");
 #define TAB printf("\t");
@@ -39,7 +42,13 @@ void print_registers(void);
 
 void print_obj(Obj obj);
 void print_list(List* list);
+void print_lambda(List* lambda);
+void print_pair(Pair* pair);
 void print_label(Label label);
+void print_form(Form form);
+void print_closure(Closure* closure);
+void print_compiled(Compiled* compiled);
+void print_instr(Instr* instr);
 char* lookup_prim_name(Obj func_obj);
 
 /* user interface */
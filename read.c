@@ -1,86 +1,295 @@
 #include "read.h"
 
-char code[BUFSIZ];
+/* typed (or piped) in and not read yet. names are
+	interned as they're read, so it can be reused */
+
+char* input = NULL;
+size_t input_length = 0;
+size_t input_size = 0;
+
+Reader input_reader;
+bool input_done = false;
+
+/* open files, innermost on top */
+
+Source* sources = NULL;
+int source_top = 0;
+int source_count = 0;
+
+bool scripts_loaded = false;
 
 Obj read_code(void) {
 
 	while (!lib_loaded()) {
 		char* lib_code = load_library();
 		Obj result = process_code_text(lib_code);
-		return result;
+		return analyze(result);
 	}
 
 	if (LIB) toggle_val(&LIB);
 
-	input_prompt();
+	Obj form = read_source();
+	if (GETTAG(form) != DUMMY)
+		return analyze(form);
 
-	while (isSpecial(code)) {
-		if (isFlag(code)) {
-			switch_flag(code);
-			print_flags();
-		}
-		else if (isHelp(code))
-			print_help();
+	if (scripts_loaded)
+		return NAMEOBJ(intern(QUIT_COMMAND));
+
+	// what's left of the last input first
+	form = read_input();
+
+	while (GETTAG(form) == DUMMY) {
+		// the end of the input is as good as .quit
+		if (input_done)
+			return NAMEOBJ(intern(QUIT_COMMAND));
 		input_prompt();
+		form = read_input();
 	}
 
-			if (DEBUG) printf("\nLISP CODE: %s\n", code);
+	return analyze(form);
+}
+
+/* files */
 
-	Obj result = process_code_text(code);
-	return result;
+// the first path is read first
+void load_scripts(int count, char** paths) {
+	for (int i = count - 1; i >= 0; i--)
+		open_source(paths[i]);
+	scripts_loaded = count > 0;
 }
 
-/* input prompt */
+// the path can be written with or without quotes
+Obj loadFile(Obj expr) {
+	if (listLength(GETLIST(expr)) != 2) {
+		printf("wrong number of arguments -- load\n");
+		error_count++;
+		return DUMMYOBJ;
+	}
 
-void input_prompt(void) {
-	print_prompt();
-	get_input();
+	Obj path_obj = loadPath(expr);
 
-	if (isIrregular(code)) {
-		if (badSyntax(code))
-			printf("Bad syntax! Try again!\n");
-		input_prompt();
+	// there are no strings, so a path is a name
+	if (!isVar(path_obj)) {
+		printf("bad path -- load\n");
+		error_count++;
+		return path_obj;
 	}
+
+	char* path = GETSTR(path_obj);
+	int length = strlen(path);
+
+	if (length > 1 && path[0] == '"' && path[length - 1] == '"') {
+		char unquoted[length - 1];
+		memcpy(unquoted, path + 1, length - 2);
+		unquoted[length - 2] = '\0';
+		open_source(unquoted);
+	}
+	else
+		open_source(path);
+
+	return path_obj;
 }
 
-void print_prompt(void) {
-	NL;
-	printf("lispinc >>> ");
+bool open_source(char* path) {
+			if (DEBUG) printf("loading \"%s\"\n", path);
+
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+
+	if (fd < 0 || fstat(fd, &info) < 0) {
+		printf("can't open \"%s\" -- load\n", path);
+		error_count++;
+		if (fd >= 0)
+			close(fd);
+		return false;
+	}
+
+	size_t length = info.st_size;
+
+	// an empty file has nothing to map (or read)
+	if (length == 0) {
+		close(fd);
+		return true;
+	}
+
+	char* map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		printf("can't map \"%s\" -- load\n", path);
+		error_count++;
+		return false;
+	}
+
+	posix_madvise(map, length, POSIX_MADV_SEQUENTIAL);
+
+	if (source_top == source_count) {
+		source_count = source_count ? 2 * source_count : INITIAL_SOURCE_COUNT;
+		sources = realloc(sources, source_count * sizeof(Source));
+	}
+
+	Source* source = &sources[source_top++];
+	source->reader.pos = map;
+	source->reader.end = map + length;
+	source->map = map;
+	source->length = length;
+
+	return true;
 }
 
-/* NB: fgets add an extra newline at the end of input */
-void get_input(void) {
-	fgets(code, BUFSIZ, stdin);
-	// code[strlen(code) - 1] = '\0';
+// the next form from the innermost file, or DUMMYOBJ
+// (names are interned as they're read, so nothing
+// points into a file once it's been read)
+Obj read_source(void) {
+	while (source_top) {
+		Source* source = &sources[source_top - 1];
+		Obj form = read_form(&source->reader);
+		if (GETTAG(form) != DUMMY)
+			return form;
+		munmap(source->map, source->length);
+		source_top--;
+	}
+
+	return DUMMYOBJ;
 }
 
-bool isIrregular(char* code) {
-	return badSyntax(code) ||
-			isEnter(code);
+/* input */
+
+// the next form of the input, or DUMMYOBJ. a user command
+// (see flags.h) is run when it's found at the start of a line
+Obj read_input(void) {
+	while (true) {
+		skip_space(&input_reader);
+
+		char* line = input_reader.pos;
+		char* end = input_reader.end;
+
+		if (line == end)
+			return DUMMYOBJ;
+
+		char* line_end = memchr(line, '\n', end - line);
+		line_end = line_end ? line_end + 1 : end;
+
+		if (*line == '.' && run_command(line, line_end)) {
+			input_reader.pos = line_end;
+			continue;
+		}
+
+		return read_form(&input_reader);
+	}
 }
 
-bool isEnter(char* code) {
-	return streq(code, "\n");
+// whitespace and comments
+void skip_space(Reader* reader) {
+	char* pos = reader->pos;
+
+	while (pos < reader->end) {
+		if (WHITESPACE(*pos))
+			pos++;
+		else if (COMMENT(*pos))
+			while (pos < reader->end && *pos != '\n')
+				pos++;
+		else
+			break;
+	}
+
+	reader->pos = pos;
 }
 
-// other bad syntax conditions can be added later
-bool badSyntax(char* code) {
-	return !parens_balanced(code);
+bool run_command(char* line, char* line_end) {
+	char command[MAX_COMMAND_LENGTH + 2];
+	int length = line_end - line;
+
+	if (length > MAX_COMMAND_LENGTH)
+		return false;
+
+	// the commands are compared with their newlines
+	memcpy(command, line, length);
+	if (command[length - 1] != '\n')
+		command[length++] = '\n';
+	command[length] = '\0';
+
+	if (isFlag(command)) {
+		switch_flag(command);
+		print_flags();
+		return true;
+	}
+	if (isHelp(command)) {
+		print_help();
+		return true;
+	}
+	return false;
 }
 
-bool parens_balanced(char* code) {
-	int op = 0;
-	int cp = 0;
-	int len = strlen(code);
+/* in batch mode, all of the input is read at once, and
+	read_form takes it a form at a time, the same as a file.
+	At the prompt, lines are read until the parens in them
+	balance, so a form can go on for as many lines as it
+	likes, and every form on them is evaluated in turn. */
+
+void input_prompt(void) {
+	input_length = 0;
+
+	if (BATCH) {
+		get_all_input();
+		input_done = true;
+	}
+	else {
+		print_prompt();
 
-	for (int i = 0; i < len; i++) {
-		if (OPENPAREN(code[i]))
-			op++;
-		if (CLOSEPAREN(code[i]))
-			cp++;
+		while (get_line()) {
+			int balance = paren_balance(input, input + input_length);
+			if (balance == 0)
+				break;
+			if (balance < 0) {
+				printf("Bad syntax! Try again!\n");
+				error_count++;
+				input_length = 0;
+				print_prompt();
+			}
+		}
 	}
 
-	return op == cp;
+	input_reader.pos = input;
+	input_reader.end = input + input_length;
+
+			if (DEBUG) printf("\nLISP CODE: %.*s\n", (int) input_length, input);
+}
+
+void print_prompt(void) {
+	NL;
+	printf("lispinc >>> ");
+}
+
+// adds a line to the input (false at the end of the input)
+bool get_line(void) {
+	do {
+		make_room(BUFSIZ);
+		if (fgets(input + input_length, input_size - input_length, stdin) == NULL) {
+			input_done = true;
+			return false;
+		}
+		input_length += strlen(input + input_length);
+	} while (input[input_length - 1] != '\n');
+
+	return true;
+}
+
+void get_all_input(void) {
+	size_t count;
+
+	do {
+		make_room(BUFSIZ);
+		count = fread(input + input_length, 1, input_size - input_length, stdin);
+		input_length += count;
+	} while (count > 0);
+}
+
+void make_room(size_t size) {
+	while (input_size - input_length < size) {
+		input_size = input_size ? 2 * input_size : BUFSIZ;
+		input = realloc(input, input_size);
+	}
 }
 
 /* check for user commands (see flags.h) */
@@ -96,7 +305,9 @@ int isFlag(char* code) {
 			streq(code, _INFO) || 
 			streq(code, _STATS) || 
 			streq(code, _TAIL) ||
-			streq(code, _STEP);
+			streq(code, _STEP) ||
+			streq(code, _COMPILE) ||
+			streq(code, _FLAT);
 }
 
 int isHelp(char* code) {
@@ -2,18 +2,32 @@
 	READ
 
 	read.c handles input. It doesn't do anything
-	terribly interesting or exotic. Input is taken
-	from fgets. If the input is a user command,
-	then command is executed. Otherwise, the input
-	(presumed to be Lisp code) is passed to the
-	functions in parse.c.
+	terribly interesting or exotic. At the prompt,
+	lines are taken from fgets until the parens in
+	them balance; in batch mode, all of stdin is
+	read at once. Either way, the input is read a
+	form at a time by read_form (in parse.c), and
+	a line that holds a user command runs the
+	command instead.
+
+	Code can also come from files, either named on
+	the command line or loaded with (load "path").
+	A file is memory-mapped and read in place, one
+	form at a time (see read_form in parse.c), so
+	it isn't copied anywhere, and a form can be as
+	long as it likes. The open files are kept on
+	a stack of sources, and read_code takes the
+	next form from the top one before it goes back
+	to the prompt. So a load is done once the form
+	that called it has a value, as though the file's
+	forms came next in the input, and a file that
+	loads another file picks up where it left off
+	after it. When the files from the command line
+	are done, lispinc quits.
 */
 
 /*
 	TODO:
-		-- make it so that newlines don't have to be
-			added to every input string (problem
-			with tokenize in parse.c?s)
 		-- reader macros
 */
 
@@ -23,26 +37,50 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "objects.h"
 #include "keywords.h"
 #include "flags.h"
 #include "parse.h"
+#include "analyze.h"
 #include "lib.h"
 #include "print.h"
 
 Obj read_code(void);
 
-/* input prompt */
-void input_prompt(void);
+/* files */
 
-void print_prompt(void);
-void get_input(void);
-bool isIrregular(char* code);
+typedef struct {
+	Reader reader;
+	char* map;
+	size_t length;
+} Source;
+
+#define INITIAL_SOURCE_COUNT 8
+
+void load_scripts(int count, char** paths);
+Obj loadFile(Obj expr);
+
+	bool open_source(char* path);
+	Obj read_source(void);
 
-bool isEnter(char* code);
-bool badSyntax(char* code);
-bool parens_balanced(char* code);
+/* input */
+
+#define MAX_COMMAND_LENGTH 16
+
+Obj read_input(void);
+void skip_space(Reader* reader);
+bool run_command(char* line, char* line_end);
+
+void input_prompt(void);
+void print_prompt(void);
+bool get_line(void);
+void get_all_input(void);
+void make_room(size_t size);
 
 /* check for user commands */
 int isSpecial(char* code);
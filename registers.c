@@ -8,6 +8,26 @@ Obj arglist;
 Obj unev;
 Obj env;
 
+Obj* registers[reg_count] = {
+	[EXPR_REG] = &expr,
+	[VAL_REG] = &val,
+	[CONT_REG] = &cont,
+	[FUNC_REG] = &func,
+	[ARGLIST_REG] = &arglist,
+	[UNEV_REG] = &unev,
+	[ENV_REG] = &env,
+};
+
+char* register_names[reg_count] = {
+	[EXPR_REG] = "EXPR",
+	[VAL_REG] = "VAL",
+	[CONT_REG] = "CONT",
+	[FUNC_REG] = "FUNC",
+	[ARGLIST_REG] = "ARGLIST",
+	[UNEV_REG] = "UNEV",
+	[ENV_REG] = "ENV",
+};
+
 void initialize_registers(void) {
 	expr = UNINITOBJ;
 	val = UNINITOBJ;
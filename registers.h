@@ -6,6 +6,12 @@
 #include "objects.h"
 #include "print.h"
 
+/* registers as data, indexed by Reg
+	(see objects.h) */
+
+extern Obj* registers[reg_count];
+extern char* register_names[reg_count];
+
 void initialize_registers(void);
 void debug_register(Obj reg, char* name);
 
@@ -0,0 +1,210 @@
+#include "scan.h"
+
+char* (*scan_name)(char* pos, char* end) = scan_name_scalar;
+int (*paren_balance)(char* pos, char* end) = paren_balance_scalar;
+
+char* scanner_name = "scalar";
+
+#if SIMD_SCAN
+char delimiter_blocks[DELIMITER_COUNT][32];
+#endif
+
+void select_scanners(void) {
+#if SIMD_SCAN
+	for (int i = 0; i < DELIMITER_COUNT; i++)
+		memset(delimiter_blocks[i], DELIMITERS[i], 32);
+
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2") &&
+			__builtin_cpu_supports("popcnt")) {
+		scan_name = scan_name_avx2;
+		paren_balance = paren_balance_avx2;
+		scanner_name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2")) {
+		scan_name = scan_name_sse2;
+		paren_balance = paren_balance_sse2;
+		scanner_name = "sse2";
+	}
+#endif
+			if (DEBUG) printf("scanning with %s\n", scanner_name);
+}
+
+/* one character at a time */
+
+char* scan_name_scalar(char* pos, char* end) {
+	while (pos < end &&
+			!(OPENPAREN(*pos) || CLOSEPAREN(*pos) ||
+				WHITESPACE(*pos) || COMMENT(*pos)))
+		pos++;
+	return pos;
+}
+
+// parens in a comment don't count, just as read_form
+// skips them (a comment runs to the end of the line)
+int paren_balance_scalar(char* pos, char* end) {
+	bool in_comment = false;
+	return balance_scalar(pos, end, &in_comment);
+}
+
+// *in_comment says whether pos is in a comment, and is
+// left saying whether end is
+int balance_scalar(char* pos, char* end, bool* in_comment) {
+	int balance = 0;
+
+	for (; pos < end; pos++) {
+		if (*in_comment) {
+			if (*pos == '\n')
+				*in_comment = false;
+			continue;
+		}
+		if (OPENPAREN(*pos))
+			balance++;
+		if (CLOSEPAREN(*pos))
+			balance--;
+		if (COMMENT(*pos))
+			*in_comment = true;
+	}
+
+	return balance;
+}
+
+#if SIMD_SCAN
+
+/* a block at a time. each comparison gives a block
+	with 0xFF where the character matches, and
+	movemask takes the top bit of each byte. The
+	delimiters to compare against are loaded from
+	delimiter_blocks rather than made with set1,
+	which (unoptimized) builds the block a byte at
+	a time. */
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2,popcnt")))
+
+#define EQ16(B, I) _mm_cmpeq_epi8(B, \
+						_mm_loadu_si128((__m128i*) delimiter_blocks[I]))
+#define OR16(X, Y) _mm_or_si128(X, Y)
+
+#define OPEN16(B)  OR16(OR16(EQ16(B, 0), EQ16(B, 1)), EQ16(B, 2))
+#define CLOSE16(B) OR16(OR16(EQ16(B, 3), EQ16(B, 4)), EQ16(B, 5))
+#define SPACE16(B) OR16(OR16(EQ16(B, 6), EQ16(B, 7)), \
+						OR16(EQ16(B, 8), EQ16(B, 9)))
+#define DELIM16(B) OR16(OR16(OPEN16(B), CLOSE16(B)), \
+						OR16(SPACE16(B), EQ16(B, 10)))
+
+#define EQ32(B, I) _mm256_cmpeq_epi8(B, \
+						_mm256_loadu_si256((__m256i*) delimiter_blocks[I]))
+#define OR32(X, Y) _mm256_or_si256(X, Y)
+
+#define OPEN32(B)  OR32(OR32(EQ32(B, 0), EQ32(B, 1)), EQ32(B, 2))
+#define CLOSE32(B) OR32(OR32(EQ32(B, 3), EQ32(B, 4)), EQ32(B, 5))
+#define SPACE32(B) OR32(OR32(EQ32(B, 6), EQ32(B, 7)), \
+						OR32(EQ32(B, 8), EQ32(B, 9)))
+#define DELIM32(B) OR32(OR32(OPEN32(B), CLOSE32(B)), \
+						OR32(SPACE32(B), EQ32(B, 10)))
+
+/* the characters of a block that aren't in a comment, as
+	a mask, given masks of its semicolons and newlines. A
+	comment takes the bits from its ; up to (not including)
+	the next newline, so this loops once per comment in the
+	block, which is usually not at all. */
+
+unsigned live_mask(unsigned semis, unsigned newlines, unsigned full,
+					bool* in_comment) {
+	unsigned live = full;
+
+	// finishing a comment from the block before
+	if (*in_comment) {
+		if (newlines == 0)
+			return 0;
+		unsigned newline = newlines & -newlines;
+		live &= ~(newline - 1);
+		*in_comment = false;
+	}
+
+	semis &= live;
+
+	while (semis) {
+		unsigned semi = semis & -semis;
+		unsigned after = newlines & ~(semi - 1);
+
+		if (after == 0) {
+			*in_comment = true;
+			return live & (semi - 1);
+		}
+
+		unsigned newline = after & -after;
+		live &= ~((newline - 1) & ~(semi - 1));
+		semis &= ~(newline - 1);
+	}
+
+	return live;
+}
+
+// the lowest set bit of the mask is the first delimiter
+SSE2 char* scan_name_sse2(char* pos, char* end) {
+	for (; end - pos >= 16; pos += 16) {
+		__m128i block = _mm_loadu_si128((__m128i*) pos);
+		unsigned mask = _mm_movemask_epi8(DELIM16(block));
+		if (mask)
+			return pos + __builtin_ctz(mask);
+	}
+	return scan_name_scalar(pos, end);
+}
+
+SSE2 int paren_balance_sse2(char* pos, char* end) {
+	bool in_comment = false;
+	return balance_sse2(pos, end, &in_comment);
+}
+
+SSE2 int balance_sse2(char* pos, char* end, bool* in_comment) {
+	int balance = 0;
+
+	for (; end - pos >= 16; pos += 16) {
+		__m128i block = _mm_loadu_si128((__m128i*) pos);
+		unsigned live = live_mask(
+			_mm_movemask_epi8(EQ16(block, 10)),
+			_mm_movemask_epi8(EQ16(block, 7)),
+			0xFFFF, in_comment);
+		balance += __builtin_popcount(_mm_movemask_epi8(OPEN16(block)) & live);
+		balance -= __builtin_popcount(_mm_movemask_epi8(CLOSE16(block)) & live);
+	}
+
+	return balance + balance_scalar(pos, end, in_comment);
+}
+
+// what's left after the last full block can still fill an sse2 block
+AVX2 char* scan_name_avx2(char* pos, char* end) {
+	for (; end - pos >= 32; pos += 32) {
+		__m256i block = _mm256_loadu_si256((__m256i*) pos);
+		unsigned mask = _mm256_movemask_epi8(DELIM32(block));
+		if (mask)
+			return pos + __builtin_ctz(mask);
+	}
+	return scan_name_sse2(pos, end);
+}
+
+AVX2 int paren_balance_avx2(char* pos, char* end) {
+	bool in_comment = false;
+	return balance_avx2(pos, end, &in_comment);
+}
+
+AVX2 int balance_avx2(char* pos, char* end, bool* in_comment) {
+	int balance = 0;
+
+	for (; end - pos >= 32; pos += 32) {
+		__m256i block = _mm256_loadu_si256((__m256i*) pos);
+		unsigned live = live_mask(
+			_mm256_movemask_epi8(EQ32(block, 10)),
+			_mm256_movemask_epi8(EQ32(block, 7)),
+			0xFFFFFFFF, in_comment);
+		balance += __builtin_popcount(_mm256_movemask_epi8(OPEN32(block)) & live);
+		balance -= __builtin_popcount(_mm256_movemask_epi8(CLOSE32(block)) & live);
+	}
+
+	return balance + balance_sse2(pos, end, in_comment);
+}
+
+#endif
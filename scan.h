@@ -0,0 +1,93 @@
+/*
+	SCAN
+
+	read_form spends most of its time looking for
+	the end of a name, and the prompt spends all of
+	its time counting parens to see whether a form
+	is finished. Both are questions
+	about which characters of a long string are
+	delimiters, and there's no need to ask them one
+	character at a time.
+
+	On x86, a block of 16 (SSE2) or 32 (AVX2)
+	characters is compared against every delimiter
+	at once, and the results are packed into a
+	bitmask with one bit per character. The end of
+	a name is then just the lowest set bit of the
+	delimiter mask (count trailing zeros), and the
+	paren balance of a block is the popcount of its
+	open mask minus the popcount of its close mask,
+	leaving out whatever is in a comment (which
+	read_form skips, parens and all).
+	There are no branches per character, so reading
+	a big file goes about as fast as memory does.
+	The last few characters of a string (fewer than
+	a block) are done one at a time.
+
+	The delimiters are the same ones keywords.h
+	defines: parens (all three kinds), whitespace
+	and ; (which starts a comment). Anything else
+	is part of a name, " included: there's no
+	string syntax, so a paren between quotes counts
+	here just as it does to the reader.
+
+	scan_name and paren_balance are function
+	pointers. select_scanners asks the CPU (through
+	CPUID) what it supports and points them at the
+	widest version it can run. Before that, and on
+	anything that isn't x86, they're plain loops.
+	(tests/scan_test.c checks that every version
+	agrees with the plain loops and with the reader.)
+*/
+
+#ifndef SCAN_GUARD
+#define SCAN_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "keywords.h"
+#include "flags.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define SIMD_SCAN 1
+	#include <immintrin.h>
+#else
+	#define SIMD_SCAN 0
+#endif
+
+// the first delimiter at or after pos (or end, if there isn't one)
+extern char* (*scan_name)(char* pos, char* end);
+
+// open parens minus close parens
+extern int (*paren_balance)(char* pos, char* end);
+
+extern char* scanner_name;
+
+void select_scanners(void);
+
+	char* scan_name_scalar(char* pos, char* end);
+	int paren_balance_scalar(char* pos, char* end);
+	int balance_scalar(char* pos, char* end, bool* in_comment);
+
+#if SIMD_SCAN
+	// in this order: open parens, close parens, whitespace, comment
+	#define DELIMITERS "([{)]} \n\t\r;"
+	#define DELIMITER_COUNT 11
+
+	// each delimiter, repeated to fill a block
+	extern char delimiter_blocks[DELIMITER_COUNT][32];
+
+	unsigned live_mask(unsigned semis, unsigned newlines, unsigned full,
+						bool* in_comment);
+	char* scan_name_sse2(char* pos, char* end);
+	int paren_balance_sse2(char* pos, char* end);
+	int balance_sse2(char* pos, char* end, bool* in_comment);
+	char* scan_name_avx2(char* pos, char* end);
+	int paren_balance_avx2(char* pos, char* end);
+	int balance_avx2(char* pos, char* end, bool* in_comment);
+#endif
+
+#endif
@@ -1,6 +1,8 @@
 #include "stack.h"
 
-List* stack;
+Obj* stack = NULL;
+int stack_top = 0;
+int stack_size = 0;
 
 /* stat counters (see print.c) */
 
@@ -18,10 +20,10 @@ void reset_stats(void) {
 
 void save(Obj reg) {
 			if (DEBUG) printf("%s\n", "save!");
-	List* temp = stack;
-	stack = malloc(sizeof(List)); // &stack?
-	stack->car = reg;
-	stack->cdr = temp;
+	if (stack_top == stack_size)
+		grow_stack();
+
+	stack[stack_top++] = reg;
 
 	save_count++;
 	curr_stack_depth++;
@@ -33,10 +35,7 @@ void save(Obj reg) {
 
 void restore(Obj* reg) {
 			if (DEBUG) printf("%s\n", "restore!");
-	*reg = stack->car;
-	List* temp = stack;
-	stack = stack->cdr;
-	free(temp);
+	*reg = stack[--stack_top];
 
 	curr_stack_depth--;
 	return;
@@ -44,20 +43,21 @@ void restore(Obj* reg) {
 
 /* stack management */
 
-#define empty_stack NULL
-
 void clear_stack(void) {
-	List* temp = stack;
-	while (stack) {
-		stack = stack->cdr;
-		free(temp);
-		temp = stack;
-	}
+	stack_top = 0;
 	return;
 }
 
 void initialize_stack(void) {
+	if (stack == NULL)
+		grow_stack();
 	clear_stack();
-	stack = empty_stack;
 	return;
-}
\ No newline at end of file
+}
+
+// doubles the stack (amortized constant time per save)
+void grow_stack(void) {
+	stack_size = stack_size ? 2 * stack_size : INITIAL_STACK_SIZE;
+	stack = realloc(stack, stack_size * sizeof(Obj));
+			if (DEBUG) printf("stack grown to %d\n", stack_size);
+}
@@ -1,10 +1,12 @@
 /*
 	STACK
 
-	The stack is represented as a List, i.e.
-	a pointer to a linked list of Objs 
-	(see objects.h). It creates the illusion
-	of infinite memory. You might think that
+	The stack is represented as a contiguous
+	array of Objs, with stack_top the index of
+	the first free slot. When the array fills up,
+	it's reallocated at twice the size, so a save
+	almost never allocates anything. It creates
+	the illusion of infinite memory. You might think that
 	the stack would be necessary because the
 	interpreter needs it to run recursive
 	functions. In fact, the stack is needed
@@ -46,6 +48,12 @@ extern int save_count;
 extern int curr_stack_depth;
 extern int max_stack_depth;
 
-extern List* stack;
+extern Obj* stack;
+extern int stack_top;
+extern int stack_size;
+
+#define INITIAL_STACK_SIZE 256
+
+	void grow_stack(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "symbol.h"
+
+Symbol** symbol_buckets = NULL;
+int symbol_bucket_count = 0;
+
+int symbol_count = 0;
+size_t symbol_bytes = 0;
+
+/* keywords are interned first, in Form order */
+
+void initialize_symbols(void) {
+	if (symbol_buckets)
+		return;
+
+	symbol_bucket_count = INITIAL_SYMBOL_BUCKETS;
+	symbol_buckets = calloc(symbol_bucket_count, sizeof(Symbol*));
+
+	intern(QUOTE_KEY);
+	intern(FUN_KEY);
+	intern(BEGIN_KEY);
+	intern(ASS_KEY);
+	intern(DEF_KEY);
+	intern(IF_KEY);
+	intern(LOAD_KEY);
+}
+
+Symbol* intern(char* name) {
+	return intern_n(name, strlen(name));
+}
+
+// name doesn't have to be null-terminated
+Symbol* intern_n(char* name, int length) {
+	if (symbol_buckets == NULL)
+		initialize_symbols();
+
+	unsigned hash = hash_name(name, length);
+	Symbol* sym = symbol_buckets[hash & (symbol_bucket_count - 1)];
+
+	while (sym) {
+		if (sym->hash == hash &&
+			strncmp(sym->name, name, length) == 0 &&
+			sym->name[length] == '\0')
+				return sym;
+		sym = sym->next;
+	}
+
+			if (DEBUG) printf("interning \"%.*s\"\n", length, name);
+
+	sym = malloc(sizeof(Symbol) + length + 1);
+	memcpy(sym->name, name, length);
+	sym->name[length] = '\0';
+	sym->hash = hash;
+	sym->id = symbol_count;
+
+	int bucket = hash & (symbol_bucket_count - 1);
+	sym->next = symbol_buckets[bucket];
+	symbol_buckets[bucket] = sym;
+
+	symbol_count++;
+	symbol_bytes += sizeof(Symbol) + length + 1;
+
+	if (symbol_count > symbol_bucket_count)
+		grow_symbols();
+
+	return sym;
+}
+
+// indexed by id (the caller frees the array)
+Symbol** all_symbols(void) {
+	Symbol** symbols = malloc(symbol_count * sizeof(Symbol*));
+
+	for (int i = 0; i < symbol_bucket_count; i++)
+		for (Symbol* sym = symbol_buckets[i]; sym; sym = sym->next)
+			symbols[sym->id] = sym;
+
+	return symbols;
+}
+
+bool isKeyword(Symbol* sym) {
+	return sym->id < APP_FORM;
+}
+
+size_t symbol_memory(void) {
+	return symbol_bytes + symbol_bucket_count * sizeof(Symbol*);
+}
+
+// FNV-1a
+unsigned hash_name(char* name, int length) {
+	unsigned hash = 2166136261u;
+	for (int i = 0; i < length; i++) {
+		hash ^= (unsigned char) name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void grow_symbols(void) {
+	int new_count = symbol_bucket_count * 2;
+	Symbol** new_buckets = calloc(new_count, sizeof(Symbol*));
+
+	for (int i = 0; i < symbol_bucket_count; i++) {
+		Symbol* sym = symbol_buckets[i];
+		while (sym) {
+			Symbol* next = sym->next;
+			int bucket = sym->hash & (new_count - 1);
+			sym->next = new_buckets[bucket];
+			new_buckets[bucket] = sym;
+			sym = next;
+		}
+	}
+
+	free(symbol_buckets);
+	symbol_buckets = new_buckets;
+	symbol_bucket_count = new_count;
+}
@@ -0,0 +1,57 @@
+/*
+	SYMBOL
+
+	Every name the system sees (identifiers read
+	from code, primitive names, keywords) is
+	interned in a global symbol table: there is
+	exactly one Symbol for each distinct name, and
+	a NAME Obj holds a pointer to it. Two names are
+	the same name exactly when their pointers are
+	equal, so environment lookup never has to
+	compare strings.
+
+	A Symbol holds its own name (in the same
+	allocation), its hash, and an id. ids are handed
+	out in order of interning. initialize_symbols
+	interns the special-form keywords first, in the
+	order of the Form enum (see objects.h), so that
+	a keyword's id is its Form and analyze.c can
+	recognize special forms without looking at the
+	name at all.
+
+	The table itself is an array of buckets (chained
+	through the Symbols), doubled whenever it fills
+	up. symbol_memory reports how much memory the
+	table and its Symbols take up (see print_stats).
+*/
+
+#ifndef SYMBOL_GUARD
+#define SYMBOL_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "objects.h"
+#include "keywords.h"
+#include "flags.h"
+
+#define INITIAL_SYMBOL_BUCKETS 256
+
+void initialize_symbols(void);
+
+Symbol* intern(char* name);
+Symbol* intern_n(char* name, int length);
+
+Symbol** all_symbols(void);
+
+bool isKeyword(Symbol* sym);
+
+extern int symbol_count;
+size_t symbol_memory(void);
+
+	unsigned hash_name(char* name, int length);
+	void grow_symbols(void);
+
+#endif
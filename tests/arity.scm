@@ -0,0 +1,26 @@
+(define f (lambda (a b) b))
+(define junk (cons 1 (cons 2 nil)))
+(f 1)
+(f 1 2 3)
+(f 1 2)
+(cons 1)
+(car 1 2)
+.compile
+(define g (lambda (a b) b))
+(define junk (cons 1 (cons 2 nil)))
+(g 1)
+(g 1 2 3)
+(g 1 2)
+(cons 1)
+(car 1 2)
+.flat
+(define h (lambda (a b) b))
+(define junk (cons 1 (cons 2 nil)))
+(h 1)
+(h 1 2 3)
+(h 1 2)
+(define k ((lambda (x) (lambda (a) (cons x a))) 1))
+(k)
+(k 2 3)
+(k 2)
+.quit
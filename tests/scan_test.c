@@ -0,0 +1,136 @@
+/*
+	every version of scan_name and paren_balance this CPU
+	can run has to agree with a plain loop written the way
+	read_form reads: a comment runs from ; to the end of the
+	line, parens and all. the inputs are random strings,
+	mostly delimiters, started at every offset of a block,
+	plus some whole forms that have to balance to 0
+*/
+
+#include "../scan.h"
+
+int DEBUG = 0;
+
+#define RUNS 200000
+#define MAX_LENGTH 260
+
+// read_form's view of the parens
+int reader_balance(char* pos, char* end) {
+	int balance = 0;
+
+	while (pos < end) {
+		if (COMMENT(*pos)) {
+			while (pos < end && *pos != '\n')
+				pos++;
+			continue;
+		}
+		if (OPENPAREN(*pos))
+			balance++;
+		if (CLOSEPAREN(*pos))
+			balance--;
+		pos++;
+	}
+
+	return balance;
+}
+
+// and of the end of a name
+char* reader_name_end(char* pos, char* end) {
+	while (pos < end &&
+			!(OPENPAREN(*pos) || CLOSEPAREN(*pos) ||
+				WHITESPACE(*pos) || COMMENT(*pos)))
+		pos++;
+	return pos;
+}
+
+typedef struct {
+	char* name;
+	char* (*scan_name)(char* pos, char* end);
+	int (*paren_balance)(char* pos, char* end);
+} Scanner;
+
+Scanner scanners[3];
+int scanner_count = 0;
+
+void add_scanners(void) {
+	scanners[scanner_count++] = (Scanner)
+		{ "scalar", scan_name_scalar, paren_balance_scalar };
+#if SIMD_SCAN
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		scanners[scanner_count++] = (Scanner)
+			{ "sse2", scan_name_sse2, paren_balance_sse2 };
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		scanners[scanner_count++] = (Scanner)
+			{ "avx2", scan_name_avx2, paren_balance_avx2 };
+#endif
+}
+
+// each is one whole form, with parens in its comments and
+// comments that run from one block into the next
+char* forms[] = {
+	"(foo) ; )",
+	"(define (f x) ; (((\n  x)",
+	"(a ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;; ))\n)",
+	"(1 2 3 4 5 6 7 8 9 10 11 12 ; ))))))))))))))))))))))))))))))))))\n"
+		"(13 ; (((((((((((((((((((((((((((((((((((((((((((((((((((\n 14)\n"
+		";\n;\n; ]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]\n)",
+	"[x {y ; }\r\n z} ;\n w]"
+};
+
+bool check(Scanner* scanner, char* pos, char* end) {
+	if (scanner->paren_balance(pos, end) != reader_balance(pos, end)) {
+		printf("%s: paren_balance disagrees on \"%.*s\"\n",
+				scanner->name, (int) (end - pos), pos);
+		return false;
+	}
+	if (scanner->scan_name(pos, end) != reader_name_end(pos, end)) {
+		printf("%s: scan_name disagrees on \"%.*s\"\n",
+				scanner->name, (int) (end - pos), pos);
+		return false;
+	}
+	return true;
+}
+
+int main(void) {
+	// fills in the delimiter blocks the SIMD versions use
+	select_scanners();
+	add_scanners();
+
+	int form_count = sizeof(forms) / sizeof(char*);
+
+	for (int i = 0; i < form_count; i++) {
+		char* end = forms[i] + strlen(forms[i]);
+
+		for (int s = 0; s < scanner_count; s++) {
+			if (scanners[s].paren_balance(forms[i], end) != 0) {
+				printf("%s: form %d doesn't balance\n", scanners[s].name, i);
+				return EXIT_FAILURE;
+			}
+			for (char* pos = forms[i]; pos < end; pos++)
+				if (!check(&scanners[s], pos, end))
+					return EXIT_FAILURE;
+		}
+	}
+
+	char alphabet[] = "ab(){}[] \n\n\n\t\r;;;x1-?\"\xff";
+	char buffer[MAX_LENGTH];
+
+	srand(2);
+
+	for (int run = 0; run < RUNS; run++) {
+		int length = rand() % MAX_LENGTH;
+		for (int i = 0; i < length; i++)
+			buffer[i] = rand() % 3 ?
+				"()a; \n"[rand() % 6] :
+				alphabet[rand() % (sizeof(alphabet) - 1)];
+
+		char* start = buffer + rand() % (length + 1);
+
+		for (int s = 0; s < scanner_count; s++)
+			if (!check(&scanners[s], start, buffer + length))
+				return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#include "vm.h"
+
+Instr* pc;
+
+bool flag;
+
+#define TARGET (*registers[instr->target])
+
+VMStatus execute(void) {
+	Instr* instr;
+
+	while (true) {
+		instr = pc++;
+				if (INFO) { printf("\n\n@ VM -- "); print_instr(instr); NL; print_info(); }
+
+		switch (instr->op) {
+
+			/* assign */
+
+			case ASSIGN_CONST:
+				TARGET = instr->obj;
+				break;
+
+			case ASSIGN_REG:
+				TARGET = *registers[instr->source];
+				break;
+
+			case ASSIGN_LABEL:
+				TARGET = CODEOBJ(instr->label);
+				break;
+
+			// an internal define that hasn't happened yet
+			// is unassigned
+			case LEXICAL_LOOKUP:
+				TARGET = lexicalLookup(instr->depth, instr->offset, env);
+				if (GETTAG(TARGET) == UNINIT) {
+					expr = instr->obj;
+					return VM_UNBOUND;
+				}
+				break;
+
+			// depth and offset hold the inline cache
+			case GLOBAL_LOOKUP:
+				TARGET = cachedGlobalLookup(GETNAME(instr->obj),
+							&instr->depth, &instr->offset);
+				if (GETTAG(TARGET) == DUMMY) {
+					expr = instr->obj;
+					return VM_UNBOUND;
+				}
+				break;
+
+			case MAKE_COMPILED:
+				TARGET = makeCompiled(instr->label, instr->obj, env);
+				break;
+
+			// every procedure starts here, so it's a safe
+			// point for the garbage collector
+			case COMPILED_ENV:
+				if (gc_pending) collect_garbage();
+				TARGET = compiledEnv(func);
+				break;
+
+			// compiled code doesn't save cont before a call, so
+			// its frames are made one deeper than the stack to
+			// die at the same point as interpreted ones (see
+			// popFrames in env.c)
+			case EXTEND_ENV:
+				popFrames(stack_top + 1);
+				TARGET = extendEnv(instr->obj, instr->offset, arglist, env);
+				if (GETTAG(TARGET) == DUMMY)
+					return VM_ERROR;
+				GETENV(TARGET)->depth = stack_top + 1;
+				pushFrame(TARGET);
+				break;
+
+			case MAKE_ARGS:
+				TARGET = makeArgs(instr->offset);
+				break;
+
+			// the arglist is garbage once the primitive is done
+			case APPLY_PRIM: {
+				Obj result = applyPrimitive(func, arglist);
+				releaseArgs(arglist);
+				arglist = LISTOBJ(NULL);
+				TARGET = result;
+				break;
+			}
+
+			case LOAD_FILE:
+				TARGET = loadFile(instr->obj);
+				break;
+
+			/* perform */
+
+			case SET_ARG:
+				setArg(TARGET, instr->offset, *registers[instr->source]);
+				break;
+
+			case DEFINE_VAR:
+				defineVar(instr->obj, val, &env);
+				break;
+
+			case SET_VAR:
+				setVar(instr->obj, val, env);
+				break;
+
+			case LEXICAL_SET:
+				lexicalSet(instr->depth, instr->offset, val, env);
+				break;
+
+			case GLOBAL_SET:
+				setVar(instr->obj, val, ENVOBJ(base_env));
+				break;
+
+			/* test */
+
+			case TEST_FALSE:
+				flag = !isTrue(val);
+				break;
+
+			case TEST_PRIM:
+				flag = isPrimitive(func);
+				break;
+
+			case TEST_COMPILED:
+				flag = isCompiled(func);
+				break;
+
+			/* control */
+
+			case BRANCH:
+				if (flag)
+					pc = instr->label;
+				break;
+
+			case GOTO_LABEL:
+				pc = instr->label;
+				break;
+
+			case GOTO_REG:
+				popFrames(stack_top + 1);
+				if (GETTAG(TARGET) != CODE)
+					return VM_RETURN;
+				pc = GETCODE(TARGET);
+				break;
+
+			case GOTO_ENTRY:
+				pc = compiledEntry(func);
+				break;
+
+			// the evaluator's APPLY expects the continuation on the stack
+			case APPLY_INTERP:
+				if (GETTAG(cont) == CODE) {
+					save(cont);
+					cont = LABELOBJ(_RESUME_COMPILED);
+				}
+				save(cont);
+				return VM_APPLY;
+
+			case SAVE:
+				save(TARGET);
+				break;
+
+			case RESTORE:
+				restore(&TARGET);
+				break;
+
+			default:
+				printf("execute: unknown instruction!\n");
+				exit(1);
+		}
+	}
+}
@@ -0,0 +1,137 @@
+/*
+	VM
+
+	The explicit-control evaluator in ec_main.c
+	interprets list structure directly: every visit
+	to a subexpression walks List cells to find out
+	what it is and where its pieces are. SICP 5.5
+	gets rid of that work by compiling expressions
+	ahead of time into register-machine code that
+	does only what the evaluator would have done
+	for that particular expression.
+
+	compile.c generates that code, and vm.c runs it.
+	The machine is the same one the evaluator runs
+	on: the seven registers in registers.c and the
+	stack in stack.c. There is one extra register,
+	pc, which points to the next instruction, and a
+	flag that's set by test instructions and read by
+	branch instructions.
+
+	An instruction is an Instr: an Op plus whatever
+	operands that Op uses (a target register, a
+	source register, a constant Obj, a label). The
+	operations are just the ones the SICP compiler
+	emits:
+
+		assign (constants, registers, labels, and
+			the ops lexical-address-lookup,
+			global-lookup,
+			make-compiled-procedure,
+			compiled-procedure-env,
+			extend-environment, make-arglist,
+			apply-primitive-procedure and load)
+		perform (set-arg!, define-variable!,
+			set-variable-value!, lexical-address-set!,
+			global-set!)
+		test (false?, primitive-procedure?,
+			compiled-procedure?)
+		branch, goto, save, restore
+
+	Compiled and interpreted code call each other
+	the way SICP exercise 5.47 suggests. The
+	evaluator's APPLY jumps into compiled code when
+	func is a compiled procedure, and compiled code
+	hands compound (interpreted) procedures back to
+	the evaluator's APPLY with the continuation on
+	the stack. Since the evaluator's labels are enums
+	rather than addresses, a compiled continuation
+	(a CODE Obj) is saved underneath the label
+	_RESUME_COMPILED, which pops it back off and
+	re-enters the VM.
+
+	Instead of SICP's list and cons, arglists are
+	built with make-arglist, which allocates an
+	argument vector with offset slots, and set-arg!,
+	which puts val in slot offset (see makeArgs in
+	env.c).
+
+	execute runs from pc until it needs something
+	from the evaluator, and returns a VMStatus
+	saying what that is.
+*/
+
+#ifndef VM_GUARD
+#define VM_GUARD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "objects.h"
+#include "flags.h"
+#include "registers.h"
+#include "stack.h"
+#include "env.h"
+#include "llh.h"
+#include "read.h"
+
+typedef enum {
+	/* assign */
+	ASSIGN_CONST,
+	ASSIGN_REG,
+	ASSIGN_LABEL,
+	LEXICAL_LOOKUP,
+	GLOBAL_LOOKUP,
+	MAKE_COMPILED,
+	COMPILED_ENV,
+	EXTEND_ENV,
+	MAKE_ARGS,
+	APPLY_PRIM,
+	LOAD_FILE,
+	/* perform */
+	SET_ARG,
+	DEFINE_VAR,
+	SET_VAR,
+	LEXICAL_SET,
+	GLOBAL_SET,
+	/* test */
+	TEST_FALSE,
+	TEST_PRIM,
+	TEST_COMPILED,
+	/* control */
+	BRANCH,
+	GOTO_LABEL,
+	GOTO_REG,
+	GOTO_ENTRY,
+	APPLY_INTERP,
+	SAVE,
+	RESTORE,
+	/* only used during assembly */
+	LABEL_MARK,
+	op_count
+} Op;
+
+struct Instr {
+	Op op;
+	Reg target;
+	Reg source;
+	Obj obj;
+	Instr* label;
+	int depth;
+	int offset;
+};
+
+typedef enum {
+	VM_RETURN, // cont holds an evaluator Label
+	VM_APPLY, // apply func to arglist; continuation saved
+	VM_UNBOUND, // expr holds an unbound variable
+	VM_ERROR, // an error has been reported
+	vmstatus_count
+} VMStatus;
+
+extern Instr* pc;
+
+VMStatus execute(void);
+
+#endif